@@ -1,4 +1,5 @@
 #include "Particle.h"
+#include "shader_program.h"
 #include <stdexcept>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/type_ptr.hpp>
@@ -20,10 +21,10 @@ namespace game {
 
 	}
 	
-	void Particle::SetupShader(GLuint program, Camera* camera) {
-		SceneNode::SetupShader(program,camera);
+	void Particle::SetupShader(GLuint program) {
+		SceneNode::SetupShader(program);
 
-		GLint flag_var = glGetUniformLocation(program, "flag");
+		GLint flag_var = ShaderProgram::GetLocations(program).flag;
 		if (type == "Feather") {
 			glUniform1i(flag_var, 1);
 		}
@@ -36,7 +36,7 @@ namespace game {
 	private:
 		std::vector<AandT*>* targetList;
 		std::string type;
-		void SetupShader(GLuint program, Camera* camera)override;
+		void SetupShader(GLuint program)override;
 	private:
 
 
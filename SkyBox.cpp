@@ -9,9 +9,7 @@ void game::SkyBox::Update(void)
 {
 	SceneNode::UpdateNodeInfo();
 
-	if (children->size() > 0) {
-		for (int i = 0; i < children->size(); i++) {
-			(*children)[i]->Update();
-		}
+	for (SceneNode *child = firstChild; child; child = child->GetNextSibling()) {
+		child->Update();
 	}
 }
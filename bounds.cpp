@@ -0,0 +1,107 @@
+#include <cfloat>
+
+#include "bounds.h"
+
+namespace game {
+
+Bounds::Bounds(void) : min(FLT_MAX), max(-FLT_MAX), infinite(false) {
+}
+
+
+Bounds Bounds::Infinite(void) {
+
+	Bounds bounds;
+	bounds.min = glm::vec3(-FLT_MAX);
+	bounds.max = glm::vec3(FLT_MAX);
+	bounds.infinite = true;
+	return bounds;
+}
+
+
+void Bounds::Extend(const glm::vec3 &point) {
+
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+
+void Bounds::Extend(const Bounds &other) {
+
+	if (other.infinite) {
+		*this = other;
+		return;
+	}
+	if (infinite || other.IsEmpty()) {
+		return;
+	}
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+
+Bounds Bounds::Transform(const glm::mat4 &matrix) const {
+
+	if (infinite || IsEmpty()) {
+		return *this;
+	}
+
+	// Center and half extent; the extent of the result sums the absolute
+	// contributions of each axis
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extent = (max - min) * 0.5f;
+	glm::vec3 new_center = glm::vec3(matrix * glm::vec4(center, 1.0));
+	glm::vec3 new_extent(0.0);
+	for (int i = 0; i < 3; i++) {
+		new_extent += glm::abs(glm::vec3(matrix[i])) * extent[i];
+	}
+
+	Bounds result;
+	result.min = new_center - new_extent;
+	result.max = new_center + new_extent;
+	return result;
+}
+
+
+void Frustum::SetMatrix(const glm::mat4 &m) {
+
+	// Rows of the matrix (glm is column-major)
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	planes_[0] = row[3] + row[0]; // left
+	planes_[1] = row[3] - row[0]; // right
+	planes_[2] = row[3] + row[1]; // bottom
+	planes_[3] = row[3] - row[1]; // top
+	planes_[4] = row[3] + row[2]; // near
+	planes_[5] = row[3] - row[2]; // far
+	for (int i = 0; i < 6; i++) {
+		planes_[i] /= glm::length(glm::vec3(planes_[i]));
+	}
+}
+
+
+bool Frustum::Intersects(const Bounds &bounds) const {
+
+	if (bounds.infinite) {
+		return true;
+	}
+	if (bounds.IsEmpty()) {
+		return false;
+	}
+
+	// Outside as soon as the corner furthest along a plane normal is behind it
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4 &plane = planes_[i];
+		glm::vec3 corner(plane.x >= 0 ? bounds.max.x : bounds.min.x,
+			plane.y >= 0 ? bounds.max.y : bounds.min.y,
+			plane.z >= 0 ? bounds.max.z : bounds.min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace game
@@ -0,0 +1,49 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include <glm/glm.hpp>
+
+namespace game {
+
+	// Axis-aligned bounding box
+	// A default box is empty and grows as points or boxes are added. An
+	// infinite box stands for geometry whose extent is not known on the CPU
+	// (particles moved by their shader) and is never culled
+	struct Bounds {
+
+		glm::vec3 min;
+		glm::vec3 max;
+		bool infinite;
+
+		Bounds(void);
+		static Bounds Infinite(void);
+
+		bool IsEmpty(void) const { return !infinite && (min.x > max.x || min.y > max.y || min.z > max.z); }
+
+		// Grow the box to hold a point or another box
+		void Extend(const glm::vec3 &point);
+		void Extend(const Bounds &other);
+
+		// Box holding this one after a transformation
+		Bounds Transform(const glm::mat4 &matrix) const;
+	};
+
+	// View volume of a camera, as six planes facing inwards
+	class Frustum {
+
+	public:
+		// Planes of a combined projection * view matrix
+		void SetMatrix(const glm::mat4 &view_projection);
+
+		// False when the box is entirely outside; empty boxes are outside and
+		// infinite ones inside
+		bool Intersects(const Bounds &bounds) const;
+
+	private:
+		glm::vec4 planes_[6]; // xyz normal, w distance
+
+	}; // class Frustum
+
+} // namespace game
+
+#endif // BOUNDS_H_
@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "camera.h"
+#include "uniform_blocks.h"
 
 namespace game {
 
@@ -126,22 +127,39 @@ void Camera::SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GL
 }
 
 
-void Camera::SetupShader(GLuint program){
+Camera::State Camera::GetState(void) const {
 
-	// Update view matrix
-	SetupViewMatrix();
+    State state;
+    state.position = position_;
+    state.orientation = orientation_;
+    state.forward = forward_;
+    state.side = side_;
+    state.projection = projection_matrix_;
+    state.look_at = look_at;
+    state.view = view;
+    return state;
+}
+
+
+void Camera::SetState(const State &state){
 
-	// Set view matrix in shader
-	GLint view_mat = glGetUniformLocation(program, "view_mat");
-	glUniformMatrix4fv(view_mat, 1, GL_FALSE, glm::value_ptr(view_matrix_));
+    position_ = state.position;
+    orientation_ = state.orientation;
+    forward_ = state.forward;
+    side_ = state.side;
+    projection_matrix_ = state.projection;
+    look_at = state.look_at;
+    view = state.view;
+}
+
+
+void Camera::SetupFrame(void){
 
-	// Set projection matrix in shader
-	GLint projection_mat = glGetUniformLocation(program, "projection_mat");
-	glUniformMatrix4fv(projection_mat, 1, GL_FALSE, glm::value_ptr(projection_matrix_));
+	// Update view matrix
+	SetupViewMatrix();
 
-	// Set camera position in world coordinates
-	GLint position_vec = glGetUniformLocation(program, "camera_pos");
-	glUniform3fv(position_vec, 1, glm::value_ptr(position_));
+	// View, projection, camera position in world coordinates and time
+	UniformBlocks::SetFrame(view_matrix_, projection_matrix_, position_, (float)glfwGetTime());
 }
 
 
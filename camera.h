@@ -15,6 +15,17 @@ namespace game {
     class Camera {
 
         public:
+            // Raw camera parameters, used to snapshot and restore a camera
+            struct State {
+                glm::vec3 position;
+                glm::quat orientation;
+                glm::vec3 forward;
+                glm::vec3 side;
+                glm::mat4 projection;
+                glm::vec3 look_at;
+                int view;
+            };
+
             Camera(void);
             ~Camera();
  
@@ -23,6 +34,7 @@ namespace game {
             glm::quat GetOrientation(void) const;
 			std::string GetCameraName() { return name; }
 			glm::mat4 GetCurrentViewMatrix() { return view_matrix_; }
+			glm::mat4 GetProjectionMatrix() { return projection_matrix_; }
 
             // Set global camera attributes
             void SetPosition(glm::vec3 position);
@@ -52,10 +64,15 @@ namespace game {
             // Set projection from frustum parameters: field-of-view,
             // near and far planes, and width and height of viewport
             void SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GLfloat h);
-            // Set all camera-related variables in shader program
-            void SetupShader(GLuint program);
+            // Update the view matrix and upload the frame block shared by
+            // all programs; called once per frame, before drawing
+            void SetupFrame(void);
 			int GetView() { return view; }
 
+            // Copy all the parameters of the camera
+            State GetState(void) const;
+            void SetState(const State &state);
+
         private:
 			std::string name; // Camera name, used for identifing different camera
 			glm::vec3 position_; // Position of camera
@@ -1,4 +1,5 @@
 #include "camera_node.h"
+#include "render_queue.h"
 
 game::CameraNode::CameraNode(Camera * c, std::string cameraName) :SceneNode(cameraName, NULL, NULL) {
 	camera = c; 
@@ -21,23 +22,27 @@ void game::CameraNode::Pitch(float angle)
 {
 	camera->Pitch(angle);
 	orientation_ = camera->GetOrientation();
+	MarkDirty();
 }
 
 void game::CameraNode::Yaw(float angle)
 {
 	camera->Yaw(angle);
 	orientation_ = camera->GetOrientation();
+	MarkDirty();
 }
 
 void game::CameraNode::Roll(float angle)
 {
 	camera->Roll(angle);
 	orientation_ = camera->GetOrientation();
+	MarkDirty();
 }
 
 void game::CameraNode::SetPosition(glm::vec3 position)
 {
 	position_ = position;
+	MarkDirty();
 	camera->SetPosition(position_);
 
 }
@@ -45,27 +50,33 @@ void game::CameraNode::SetPosition(glm::vec3 position)
 void game::CameraNode::SetOrientation(glm::quat orientation)
 {
 	orientation_ = orientation;
+	MarkDirty();
 	camera->SetOrientation(orientation_);
 }
 
 
-void game::CameraNode::Draw(Camera * camera)
+void game::CameraNode::Submit(RenderQueue *queue, Camera * camera)
 {
-	for (int i = 0; i < (*children).size(); i++) {
-		if ((*children)[i]->GetName() != "Body" && camera->GetCameraName() == "Camera") (*children)[i]->Draw(camera);
-		else if (camera->GetCameraName() == "ThirdCamera" || camera->GetCameraName() == "OverlookCamera")(*children)[i]->Draw(camera);
+	if (!queue->IsVisible(GetSubtreeBounds())) {
+		return;
+	}
+
+	// Looking through this camera hides the bird body attached to it
+	for (SceneNode *child = firstChild; child; child = child->GetNextSibling()) {
+		if (camera != this->camera || child->GetKind() != BirdBodyKind) child->Submit(queue, camera);
 
 	}
 }
 
 void game::CameraNode::Update(void)
 {
-	if (GetCamera()->GetCameraName() == "Camera") {
+	if (kind_ == FirstCameraKind) {
 		camera->SetLookAt(position_ + (float)800 * camera->GetForward());
 	}
-	else if (GetCamera()->GetCameraName()=="ThirdCamera") {
+	else if (kind_ == ThirdCameraKind) {
 		camera->SetLookAt(parent->GetPosition());
 		position_ = parent->GetPosition() + glm::vec3(-8, 12, 32);
+		MarkDirty();
 	}
 
 	
@@ -86,9 +97,7 @@ void game::CameraNode::Update(void)
 	SceneNode::UpdateNodeInfo();
 	camera->SetPosition(position_);
 	camera->SetOrientation(orientation_);
-	if (children->size() > 0) {
-		for (int i = 0; i < children->size(); i++) {
-			(*children)[i]->Update();
-		}
+	for (SceneNode *child = firstChild; child; child = child->GetNextSibling()) {
+		child->Update();
 	}
 }
@@ -1,3 +1,4 @@
+#pragma once
 #include "camera.h"
 #include "scene_node.h"
 #include <GL/glew.h>
@@ -9,11 +10,12 @@ namespace game {
 
 
 	public:
+		// The node takes ownership of the camera
 		CameraNode(Camera* c, std::string cameraName);
-		~CameraNode() {};
+		~CameraNode() { delete camera; };
 
 		Camera* GetCamera() { return camera; }
-		void SetCamera(Camera* c) { camera = c; }
+		void SetCamera(Camera* c) { if (c != camera) { delete camera; camera = c; } }
 		
 		virtual glm::vec3 GetPosition(void) const;
 		virtual glm::quat GetOrientation(void) const;
@@ -26,7 +28,7 @@ namespace game {
 		virtual void SetPosition(glm::vec3 position);
 		virtual void SetOrientation(glm::quat orientation);
 
-		virtual void Draw(Camera *camera);
+		virtual void Submit(RenderQueue *queue, Camera *camera);
 		virtual void Update(void);
 
 
@@ -19,24 +19,26 @@ void Common::Update(void){
 		angleSpeed *= -1;
 	}
 	angle += angleSpeed;
-	Rotate(glm::normalize(glm::angleAxis(angleSpeed*glm::pi<float>(), rotAxis)));
+	if (angleSpeed != 0) {
+		Rotate(glm::normalize(glm::angleAxis(angleSpeed*glm::pi<float>(), rotAxis)));
+	}
 
 	if ((transSpeed != 0) && (transRange != 0) && (abs(offset + transSpeed) >= abs(transRange))) {
 		transSpeed *= -1;
 	}
 	offset += transSpeed;
-	Translate(offset* transRange *transAxis);
+	if (offset * transRange != 0) {
+		Translate(offset* transRange *transAxis);
+	}
 
 	SceneNode::UpdateNodeInfo();
 
-	if (children->size() > 0) {
-		for (int i = 0; i < children->size(); i++) {
-			(*children)[i]->Update();
-		}
+	for (SceneNode *child = firstChild; child; child = child->GetNextSibling()) {
+		child->Update();
 	}
 
 	// melee control
-	if (name_ == "Body") {
+	if (kind_ == BirdBodyKind) {
 		if (animation_melee < 0) {
 			SetAngleSpeed(0);
 		}
@@ -48,10 +50,10 @@ void Common::Update(void){
 	// fire control
 	animation_fire -= 1;
 	if (animation_fire < 0 && abs(angleSpeed) * 1000 == 20) {
-		if (name_ == "LWing" || name_ == "LWing_tip") {
+		if (kind_ == LeftWingKind) {
 			angleSpeed = 0.01;
 		}
-		if (name_ == "RWing" || name_ == "RWing_tip") {
+		if (kind_ == RightWingKind) {
 			angleSpeed = -0.01;
 		}
 	}
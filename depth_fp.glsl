@@ -0,0 +1,8 @@
+#version 140
+
+// Fragment program of the depth-only variants of materials, drawn by the
+// depth pre-pass: only the depth of the fragment is written
+
+void main()
+{
+}
@@ -0,0 +1,117 @@
+#include "entity_store.h"
+
+namespace game {
+
+Archetype::Archetype(bool has_ai) {
+
+	has_ai_ = has_ai;
+}
+
+
+int Archetype::Add(SceneNode *node) {
+
+	int slot = (int)node_.size();
+	node_.push_back(node);
+	transform_.push_back(node->handle_);
+	if (has_ai_) {
+		// Start at rest on the spawn position
+		AIState ai;
+		ai.target = node->GetPosition();
+		ai.rest = 111;
+		ai.moving_center = glm::vec3(0.0, -24.9, 0.0);
+		ai.moving_radius = 130;
+		ai_.push_back(ai);
+	}
+	node->entitySlot_ = slot;
+	return slot;
+}
+
+
+void Archetype::Remove(int slot) {
+
+	int last = (int)node_.size() - 1;
+	node_[slot]->entitySlot_ = -1;
+	if (slot != last) {
+		node_[slot] = node_[last];
+		node_[slot]->entitySlot_ = slot;
+		transform_[slot] = transform_[last];
+		if (has_ai_) {
+			ai_[slot] = ai_[last];
+		}
+	}
+	node_.pop_back();
+	transform_.pop_back();
+	if (has_ai_) {
+		ai_.pop_back();
+	}
+}
+
+
+void Archetype::Clear(void) {
+
+	for (size_t i = 0; i < node_.size(); i++) {
+		node_[i]->entitySlot_ = -1;
+	}
+	node_.clear();
+	transform_.clear();
+	ai_.clear();
+}
+
+
+EntityStore::EntityStore(void) : drones_(true), hens_(true), chickens_(true), missiles_(false) {
+}
+
+
+EntityStore::~EntityStore() {
+}
+
+
+Archetype *EntityStore::Find(NodeKind kind) {
+
+	switch (kind) {
+	case DroneKind: return &drones_;
+	case HenKind: return &hens_;
+	case ChickenKind: return &chickens_;
+	case MissileKind: return &missiles_;
+	default: return NULL;
+	}
+}
+
+
+void EntityStore::Add(SceneNode *node) {
+
+	Archetype *archetype = Find(node->GetKind());
+	if (archetype && node->GetEntitySlot() < 0) {
+		archetype->Add(node);
+	}
+}
+
+
+void EntityStore::Remove(SceneNode *node) {
+
+	Archetype *archetype = Find(node->GetKind());
+	if (archetype && node->GetEntitySlot() >= 0) {
+		archetype->Remove(node->GetEntitySlot());
+	}
+}
+
+
+AIState *EntityStore::GetAI(SceneNode *node) {
+
+	Archetype *archetype = Find(node->GetKind());
+	if (!archetype || node->GetEntitySlot() < 0 || !archetype->HasAI()) {
+		return NULL;
+	}
+	return &archetype->GetAI(node->GetEntitySlot());
+}
+
+
+void EntityStore::Clear(void) {
+
+	drones_.Clear();
+	hens_.Clear();
+	chickens_.Clear();
+	missiles_.Clear();
+}
+
+} // namespace game
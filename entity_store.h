@@ -0,0 +1,81 @@
+#ifndef ENTITY_STORE_H_
+#define ENTITY_STORE_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "scene_node.h"
+
+namespace game {
+
+	// AI state of drones, hens and chickens
+	struct AIState {
+		glm::vec3 target; // position the entity walks/flies to
+		float rest; // ticks to wait once the target is reached
+		glm::vec3 moving_center; // center and radius of the area the entity roams
+		float moving_radius;
+	};
+
+	// Entities that share the same set of components
+	// Components are kept in parallel contiguous arrays indexed by the entity
+	// slot; removing an entity swaps the last one into its slot
+	class Archetype {
+
+	public:
+		Archetype(bool has_ai);
+
+		// Add/remove the entity of a node
+		int Add(SceneNode *node);
+		void Remove(int slot);
+		void Clear(void);
+
+		int Size(void) const { return (int)node_.size(); }
+
+		// Components
+		SceneNode *GetNode(int slot) const { return node_[slot]; } // render and transform owner
+		int GetTransform(int slot) const { return transform_[slot]; } // slot in the transform store
+		AIState &GetAI(int slot) { return ai_[slot]; }
+		bool HasAI(void) const { return has_ai_; }
+
+	private:
+		bool has_ai_;
+		std::vector<SceneNode*> node_;
+		std::vector<int> transform_;
+		std::vector<AIState> ai_;
+
+	}; // class Archetype
+
+	// Archetype storage of the AI entities of a scene graph
+	class EntityStore {
+
+	public:
+		EntityStore(void);
+		~EntityStore();
+
+		// Add a node to the archetype of its kind; nodes of other kinds are ignored
+		void Add(SceneNode *node);
+		void Remove(SceneNode *node);
+		void Clear(void);
+
+		// AI state of a node, NULL if the node has none
+		AIState *GetAI(SceneNode *node);
+
+		Archetype &GetDrones(void) { return drones_; }
+		Archetype &GetHens(void) { return hens_; }
+		Archetype &GetChickens(void) { return chickens_; }
+		Archetype &GetMissiles(void) { return missiles_; }
+
+	private:
+		// Archetype of a kind of node, NULL if the kind is not an entity
+		Archetype *Find(NodeKind kind);
+
+		Archetype drones_;
+		Archetype hens_;
+		Archetype chickens_;
+		Archetype missiles_;
+
+	}; // class EntityStore
+
+} // namespace game
+
+#endif // ENTITY_STORE_H_
@@ -1,4 +1,4 @@
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec3 position_interp;
@@ -16,8 +16,13 @@ vec3 diffuse_albedo = vec3(0.0, 0.0, 0.5);
 vec3 specular_albedo = vec3(0.0, 0.0, 0.0);
 
 // Uniforms
-// Camera position in world coordinates
-uniform vec3 camera_pos;
+// Camera position in world coordinates, in the per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 // Uniform (global) buffer with the environment map
 uniform samplerCube env_map;
 
@@ -4,6 +4,10 @@
 
 #include "game.h"
 #include "bin/path_config.h"
+#include "shader_program.h"
+#include "gl_state.h"
+#include "uniform_blocks.h"
+#include "vertex_layout.h"
 
 namespace game {
 
@@ -81,9 +85,14 @@ namespace game {
 
 	void Game::InitView(void) {
 
+		// Set up samplers and the state cache
+		GLState::Init();
+
 		// Set up z-buffer
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
+		GLState::Enable(GL_DEPTH_TEST);
+		GLState::DepthFunc(GL_LESS);
+		// Set up the uniform buffers shared by all programs
+		UniformBlocks::Init();
 
 
 	}
@@ -252,6 +261,130 @@ namespace game {
 		resman_.CreateTriangle("Bird_wings_tip", 0.07, 0.3, 0.1, 0.66, false);
 		//							float thick, float bot, float top, float height, bool tip
 		resman_.CreateTriangle("Bird_beak", 0.2, 0.2, 0.03, 0.39, true);
+
+		// Blueprints of the characters spawned during the game
+		CompilePrefabs();
+	}
+
+
+	void Game::CompilePrefabs(void) {
+
+		ResourceSet set;
+
+		// Chicken
+		set = CollectSource("CK_Body", "CK_Body", "TexturedMaterial", "Beak", "");
+		int ck_body = chicken_prefab_.AddPart("CK_Body", set.g, set.m, set.t, set.e);
+		PrefabPart &CK_Body = chicken_prefab_.GetPart(ck_body);
+		CK_Body.kind = ChickenKind;
+		CK_Body.forward = glm::vec3(-1, 0, 0);
+		CK_Body.speed = 0.024;
+
+		set = CollectSource("CK_Head", "CK_Head", "TexturedMaterial", "Beak", "");
+		int ck_head = chicken_prefab_.AddPart("CK_Head", set.g, set.m, set.t, set.e, ck_body);
+		chicken_prefab_.GetPart(ck_head).position = glm::vec3(-0.36, 0.36, 0);
+
+		set = CollectSource("CK_Beak", "CK_Beak", "TexturedMaterial", "White", "");
+		PrefabPart &CK_Beak = chicken_prefab_.GetPart(chicken_prefab_.AddPart("CK_Beak", set.g, set.m, set.t, set.e, ck_head));
+		CK_Beak.orientation = glm::normalize(glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0)) * glm::angleAxis(180 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0)));
+		CK_Beak.position = glm::vec3(-0.7, -0.45, 0);
+
+		set = CollectSource("CK_Lleg", "CK_Legs", "TexturedMaterial", "White", "");
+		PrefabPart &CK_Lleg = chicken_prefab_.GetPart(chicken_prefab_.AddPart("CK_Lleg", set.g, set.m, set.t, set.e, ck_body));
+		CK_Lleg.angle_speed = 0.006;
+		CK_Lleg.rot_axis = glm::vec3(0, 0, 1.0);
+		CK_Lleg.rot_range = 0.12;
+		CK_Lleg.origin = glm::vec3(0, 0.5, 0);
+		CK_Lleg.position = glm::vec3(0, 0.077, 0.15);
+
+		set = CollectSource("CK_Rleg", "CK_Legs", "TexturedMaterial", "White", "");
+		PrefabPart &CK_Rleg = chicken_prefab_.GetPart(chicken_prefab_.AddPart("CK_Rleg", set.g, set.m, set.t, set.e, ck_body));
+		CK_Rleg.angle_speed = -0.006;
+		CK_Rleg.rot_axis = glm::vec3(0, 0, 1.0);
+		CK_Rleg.rot_range = 0.12;
+		CK_Rleg.origin = glm::vec3(0, 0.5, 0);
+		CK_Rleg.position = glm::vec3(0, 0.077, -0.15);
+
+		// Hen, its parts are also listed as roots of the scene
+		set = CollectSource("Hen_Body", "CK_Body", "TexturedMaterial", "Beak", "");
+		int hen_body = hen_prefab_.AddPart("Hen_Body", set.g, set.m, set.t, set.e);
+		PrefabPart &Hen_Body = hen_prefab_.GetPart(hen_body);
+		Hen_Body.kind = HenKind;
+		Hen_Body.scale = glm::vec3(2.5, 2.2, 2.0);
+		Hen_Body.forward = glm::vec3(-1, 0, 0);
+		Hen_Body.speed = 0.04;
+
+		set = CollectSource("Hen_Head", "CK_Head", "TexturedMaterial", "Beak", "");
+		int hen_head = hen_prefab_.AddPart("Hen_Head", set.g, set.m, set.t, set.e, hen_body);
+		hen_prefab_.GetPart(hen_head).position = glm::vec3(-0.36, 0.36, 0);
+		hen_prefab_.GetPart(hen_head).listed = true;
+
+		set = CollectSource("Hen_Beak", "CK_Beak", "TexturedMaterial", "White", "");
+		PrefabPart &Hen_Beak = hen_prefab_.GetPart(hen_prefab_.AddPart("Hen_Beak", set.g, set.m, set.t, set.e, hen_head));
+		Hen_Beak.orientation = glm::normalize(glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0)) * glm::angleAxis(180 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0)));
+		Hen_Beak.position = glm::vec3(-0.7, -0.45, 0);
+		Hen_Beak.listed = true;
+
+		set = CollectSource("Hen_Lleg", "CK_Legs", "TexturedMaterial", "White", "");
+		PrefabPart &Hen_Lleg = hen_prefab_.GetPart(hen_prefab_.AddPart("Hen_Lleg", set.g, set.m, set.t, set.e, hen_body));
+		Hen_Lleg.angle_speed = 0.006;
+		Hen_Lleg.rot_axis = glm::vec3(0, 0, 1.0);
+		Hen_Lleg.rot_range = 0.12;
+		Hen_Lleg.origin = glm::vec3(0, 0.5, 0);
+		Hen_Lleg.position = glm::vec3(0, 0.077, 0.15);
+		Hen_Lleg.listed = true;
+
+		set = CollectSource("Hen_Rleg", "CK_Legs", "TexturedMaterial", "White", "");
+		PrefabPart &Hen_Rleg = hen_prefab_.GetPart(hen_prefab_.AddPart("Hen_Rleg", set.g, set.m, set.t, set.e, hen_body));
+		Hen_Rleg.angle_speed = -0.006;
+		Hen_Rleg.rot_axis = glm::vec3(0, 0, 1.0);
+		Hen_Rleg.rot_range = 0.12;
+		Hen_Rleg.origin = glm::vec3(0, 0.5, 0);
+		Hen_Rleg.position = glm::vec3(0, 0.077, -0.15);
+		Hen_Rleg.listed = true;
+
+		set = CollectSource("Hen_LWing", "Hen_wings", "TexturedMaterial", "Beak", "");
+		PrefabPart &Hen_LWing = hen_prefab_.GetPart(hen_prefab_.AddPart("Hen_LWing", set.g, set.m, set.t, set.e, hen_body));
+		Hen_LWing.orientation = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
+		Hen_LWing.angle_speed = 0.012;
+		Hen_LWing.rot_axis = glm::vec3(1.0, 0, 0);
+		Hen_LWing.rot_range = 0.24;
+		Hen_LWing.origin = glm::vec3(0, -0.5, 0);
+		Hen_LWing.position = glm::vec3(0.3, 0.0, 0.3);
+		Hen_LWing.listed = true;
+
+		set = CollectSource("Hen_RWing", "Hen_wings", "TexturedMaterial", "Beak", "");
+		PrefabPart &Hen_RWing = hen_prefab_.GetPart(hen_prefab_.AddPart("Hen_RWing", set.g, set.m, set.t, set.e, hen_body));
+		Hen_RWing.orientation = glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
+		Hen_RWing.angle_speed = -0.012;
+		Hen_RWing.rot_axis = glm::vec3(1.0, 0, 0);
+		Hen_RWing.rot_range = 0.24;
+		Hen_RWing.origin = glm::vec3(0, -0.5, 0);
+		Hen_RWing.position = glm::vec3(0.3, 0, -0.3);
+		Hen_RWing.listed = true;
+
+		// Drone
+		set = CollectSource("Drone_Body", "Drone_Body", "TexturedMaterial", "Metal", "");
+		int drone_body = drone_prefab_.AddPart("Drone_Body", set.g, set.m, set.t, set.e);
+		PrefabPart &Drone_Body = drone_prefab_.GetPart(drone_body);
+		Drone_Body.kind = DroneKind;
+		Drone_Body.scale = glm::vec3(2.0, 2.0, 2.0);
+		Drone_Body.speed = 0.06;
+
+		set = CollectSource("Drone_Center", "Drone_Center", "TexturedMaterial", "White", "");
+		int drone_center = drone_prefab_.AddPart("Drone_Center", set.g, set.m, set.t, set.e, drone_body);
+		PrefabPart &Drone_Center = drone_prefab_.GetPart(drone_center);
+		Drone_Center.position = glm::vec3(0, 0.27, 0);
+		Drone_Center.angle_speed = 0.05;
+		Drone_Center.rot_axis = glm::vec3(0, 1, 0);
+
+		set = CollectSource("Drone_Prop", "Drone_Prop", "TexturedMaterial", "Metal", "");
+		PrefabPart &Drone_Prop1 = drone_prefab_.GetPart(drone_prefab_.AddPart("Drone_Prop", set.g, set.m, set.t, set.e, drone_center));
+		Drone_Prop1.orientation = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
+		Drone_Prop1.position = glm::vec3(-0.16, 0.6, 0);
+
+		PrefabPart &Drone_Prop2 = drone_prefab_.GetPart(drone_prefab_.AddPart("Drone_Prop", set.g, set.m, set.t, set.e, drone_center));
+		Drone_Prop2.orientation = glm::normalize(glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0)) * glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0)));
+		Drone_Prop2.position = glm::vec3(-0.0, 0.6, 0.16);
 	}
 
 	void Game::SetupScene(void) {
@@ -272,10 +405,12 @@ namespace game {
 		CreateScreen();
 		
 		// Create skybox
-		skybox_ = CreateSkyBoxInstance("Skybox", "CubeMesh", "SkyboxMaterial", "SkyboxCubeMap");
-		skybox_->Scale(glm::vec3(50));
-		//skybox_->Translate(glm::vec3(0.0, 100.0, 0.0));
-		scene_.AddNode(skybox_);
+		SkyBox *skybox = CreateSkyBoxInstance("Skybox", "CubeMesh", "SkyboxMaterial", "SkyboxCubeMap");
+		skybox->SetKind(SkyboxKind);
+		skybox->Scale(glm::vec3(50));
+		//skybox->Translate(glm::vec3(0.0, 100.0, 0.0));
+		scene_.AddNode(skybox);
+		skybox_ = scene_.GetRef(skybox);
 		
 		
 		// Create lakes
@@ -286,6 +421,7 @@ namespace game {
 			glm::vec3 position = getRandomPos();
 			lake->Translate(glm::vec3(position.x, -24.8, position.z));
 			lake->Rotate(glm::angleAxis(glm::pi<float>() / 2.0f, glm::vec3(1.0, 0.0, 0.0)));
+			lake->SetStatic(true);
 			scene_.AddNode(lake);
 		}
 
@@ -296,6 +432,7 @@ namespace game {
 		ground->Scale(glm::vec3(400));
 		ground->Translate(glm::vec3(0.0, -25, 0.0));
 		ground->Rotate(glm::angleAxis(glm::pi<float>() / 2.0f, glm::vec3(1.0, 0.0, 0.0)));
+		ground->SetStatic(true);
 		scene_.AddNode(ground);
 		
 
@@ -326,7 +463,13 @@ namespace game {
 			glm::vec3 position = getRandomPos();
 			CreateHen(glm::vec3(position.x, -23.7, position.y));
 		}
-		
+
+		// Merge the geometry that never moves
+		scene_.BakeStatic();
+
+		// Keep the initial dynamic nodes so that a reset does not rebuild
+		// them; the static batches are left alone by a restore
+		initial_scene_.Capture(&scene_);
 	}
 
 	void Game::spawnChicken() {
@@ -341,10 +484,9 @@ namespace game {
 			if (house == 4) { pos = glm::vec3(66.0, -23.7, -100); }
 
 			int x = rand() % 5 + 5;
-			for (int y = 1; y < x; y++) {
-				CreateChicken(glm::vec3(pos.x, -24.3, pos.y));
-				num_Chicken += 1;
-			}
+			std::vector<glm::vec3> positions(x - 1, glm::vec3(pos.x, -24.3, pos.y));
+			chicken_prefab_.Instantiate(&scene_, positions);
+			num_Chicken += x - 1;
 			CreateHen(glm::vec3(pos.x, -23.7, pos.y));
 		}
 	}
@@ -354,130 +496,24 @@ namespace game {
 			min_Drone += 5;
 
 			int x = rand() % 5 + 5;
+			std::vector<glm::vec3> positions;
 			for (int y = 1; y < x; y++) {
-				glm::vec3 position = getRandomPos();
-				CreateDrone(position);
-				num_Drone += 1;
+				positions.push_back(getRandomPos());
 			}
+			drone_prefab_.Instantiate(&scene_, positions);
+			num_Drone += x - 1;
 		}
 	}
 
 	void Game::CreateChicken(glm::vec3 pos) {
 
-		game::Common *CK_Body = CreateCommonInstance("CK_Body", "CK_Body", "TexturedMaterial", "Beak");
-		CK_Body->Scale(glm::vec3(1.0, 1.0, 1.0));
-		CK_Body->Translate(pos);
-		scene_.AddNode(CK_Body);
-
-		game::Common *CK_Head = CreateCommonInstance("CK_Head", "CK_Head", "TexturedMaterial", "Beak");
-		CK_Head->Scale(glm::vec3(1.0, 1.0, 1.0));
-		CK_Head->Translate(glm::vec3(-0.36, 0.36, 0));
-
-		game::Common *CK_Beak = CreateCommonInstance("CK_Beak", "CK_Beak", "TexturedMaterial", "White");
-		CK_Beak->Scale(glm::vec3(1.0, 1.0, 1.0));
-		glm::quat rotation_CKBeak = glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
-		CK_Beak->Rotate(rotation_CKBeak);
-		rotation_CKBeak = glm::angleAxis(180 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
-		CK_Beak->Rotate(rotation_CKBeak);
-		CK_Beak->Translate(glm::vec3(-0.7, -0.45, 0));
-
-		game::Common *CK_Lleg = CreateCommonInstance("CK_Lleg", "CK_Legs", "TexturedMaterial", "White");
-		CK_Lleg->Scale(glm::vec3(1.0, 1.0, 1.0));
-		CK_Lleg->SetAngleSpeed(0.006);
-		CK_Lleg->SetRotAxis(glm::vec3(0, 0, 1.0));
-		CK_Lleg->SetRotRange(0.12);
-		CK_Lleg->SetOrigin(glm::vec3(0, 0.5, 0));
-		CK_Lleg->Translate(glm::vec3(0, 0.077, 0.15));
-
-		game::Common *CK_Rleg = CreateCommonInstance("CK_Rleg", "CK_Legs", "TexturedMaterial", "White");
-		CK_Rleg->Scale(glm::vec3(1.0, 1.0, 1.0));
-		CK_Rleg->SetAngleSpeed(-0.006);
-		CK_Rleg->SetRotAxis(glm::vec3(0, 0, 1.0));
-		CK_Rleg->SetRotRange(0.12);
-		CK_Rleg->SetOrigin(glm::vec3(0, 0.5, 0));
-		CK_Rleg->Translate(glm::vec3(0, 0.077, -0.15));
-
-		CK_Head->SetParent(CK_Body);
-		CK_Beak->SetParent(CK_Head);
-		CK_Lleg->SetParent(CK_Body);
-		CK_Rleg->SetParent(CK_Body);
-
-		CK_Body->setTarget(CK_Body->GetPosition());
-		CK_Body->SetForward(glm::vec3(-1, 0, 0));
-		CK_Body->SetSpeed(0.024);
+		chicken_prefab_.Instantiate(&scene_, pos);
 	}
 
 
 	void Game::CreateHen(glm::vec3 pos) {
 
-		game::Common *Hen_Body = CreateCommonInstance("Hen_Body", "CK_Body", "TexturedMaterial", "Beak");
-		Hen_Body->Scale(glm::vec3(2.5, 2.2, 2.0));
-		Hen_Body->Translate(pos);
-		scene_.AddNode(Hen_Body);
-
-		game::Common *Hen_Head = CreateCommonInstance("Hen_Head", "CK_Head", "TexturedMaterial", "Beak");
-		Hen_Head->Scale(glm::vec3(1.0, 1.0, 1.0));
-		Hen_Head->Translate(glm::vec3(-0.36, 0.36, 0));
-		scene_.AddNode(Hen_Head);
-
-		game::Common *Hen_Beak = CreateCommonInstance("Hen_Beak", "CK_Beak", "TexturedMaterial", "White");
-		Hen_Beak->Scale(glm::vec3(1.0, 1.0, 1.0));
-		glm::quat rotation_Hen_Beak = glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
-		Hen_Beak->Rotate(rotation_Hen_Beak);
-		rotation_Hen_Beak = glm::angleAxis(180 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
-		Hen_Beak->Rotate(rotation_Hen_Beak);
-		Hen_Beak->Translate(glm::vec3(-0.7, -0.45, 0));
-		scene_.AddNode(Hen_Beak);
-
-		game::Common *Hen_Lleg = CreateCommonInstance("Hen_Lleg", "CK_Legs", "TexturedMaterial", "White");
-		Hen_Lleg->Scale(glm::vec3(1.0, 1.0, 1.0));
-		Hen_Lleg->SetAngleSpeed(0.006);
-		Hen_Lleg->SetRotAxis(glm::vec3(0, 0, 1.0));
-		Hen_Lleg->SetRotRange(0.12);
-		Hen_Lleg->SetOrigin(glm::vec3(0, 0.5, 0));
-		Hen_Lleg->Translate(glm::vec3(0, 0.077, 0.15));
-		scene_.AddNode(Hen_Lleg);
-
-		game::Common *Hen_Rleg = CreateCommonInstance("Hen_Rleg", "CK_Legs", "TexturedMaterial", "White");
-		Hen_Rleg->Scale(glm::vec3(1.0, 1.0, 1.0));
-		Hen_Rleg->SetAngleSpeed(-0.006);
-		Hen_Rleg->SetRotAxis(glm::vec3(0, 0, 1.0));
-		Hen_Rleg->SetRotRange(0.12);
-		Hen_Rleg->SetOrigin(glm::vec3(0, 0.5, 0));
-		Hen_Rleg->Translate(glm::vec3(0, 0.077, -0.15));
-		scene_.AddNode(Hen_Rleg);
-
-		game::Common *Hen_LWing = CreateCommonInstance("Hen_LWing", "Hen_wings", "TexturedMaterial", "Beak");
-		Hen_LWing->Scale(glm::vec3(1.0, 1.0, 1.0));
-		glm::quat rotation_Hen_Wing = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
-		Hen_LWing->Rotate(rotation_Hen_Wing);
-		Hen_LWing->SetAngleSpeed(0.012);
-		Hen_LWing->SetRotAxis(glm::vec3(1.0, 0, 0));
-		Hen_LWing->SetRotRange(0.24);
-		Hen_LWing->SetOrigin(glm::vec3(0, -0.5, 0));
-		Hen_LWing->Translate(glm::vec3(0.3, 0.0, 0.3));
-		scene_.AddNode(Hen_LWing);
-
-		game::Common *Hen_RWing = CreateCommonInstance("Hen_RWing", "Hen_wings", "TexturedMaterial", "Beak");
-		Hen_RWing->Scale(glm::vec3(1.0, 1.0, 1.0));
-		rotation_Hen_Wing = glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
-		Hen_RWing->Rotate(rotation_Hen_Wing);
-		Hen_RWing->SetAngleSpeed(-0.012);
-		Hen_RWing->SetRotAxis(glm::vec3(1.0, 0, 0));
-		Hen_RWing->SetRotRange(0.24);
-		Hen_RWing->SetOrigin(glm::vec3(0, -0.5, 0));
-		Hen_RWing->Translate(glm::vec3(0.3, 0, -0.3));
-		scene_.AddNode(Hen_RWing);
-
-		Hen_Body->setTarget(Hen_Body->GetPosition());
-		Hen_Body->SetSpeed(0.04);
-		Hen_Body->SetForward(glm::vec3(-1, 0, 0));
-		Hen_Head->SetParent(Hen_Body);
-		Hen_Beak->SetParent(Hen_Head);
-		Hen_Lleg->SetParent(Hen_Body);
-		Hen_Rleg->SetParent(Hen_Body);
-		Hen_LWing->SetParent(Hen_Body);
-		Hen_RWing->SetParent(Hen_Body);
+		hen_prefab_.Instantiate(&scene_, pos);
 	}
 
 	// not in scenegraph nodelist, special for tornado effect
@@ -492,38 +528,7 @@ namespace game {
 
 	void Game::CreateDrone(glm::vec3 pos) {
 
-		game::Common *Drone_Body = CreateCommonInstance("Drone_Body", "Drone_Body", "TexturedMaterial", "Metal");
-		Drone_Body->Scale(glm::vec3(2.0, 2.0, 2.0));
-		Drone_Body->Translate(pos);
-		scene_.AddNode(Drone_Body);
-
-		game::Common *Drone_Center = CreateCommonInstance("Drone_Center", "Drone_Center", "TexturedMaterial", "White");
-		Drone_Center->Scale(glm::vec3(1.0, 1.0, 1.0));
-		Drone_Center->Translate(glm::vec3(0, 0.27, 0));
-		Drone_Center->SetAngleSpeed(0.05);
-		Drone_Center->SetRotAxis(glm::vec3(0, 1, 0));
-
-		game::Common *Drone_Prop1 = CreateCommonInstance("Drone_Prop", "Drone_Prop", "TexturedMaterial", "Metal");
-		Drone_Prop1->Scale(glm::vec3(1.0, 1.0, 1.0));
-		glm::quat rotation_Prop1 = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
-		Drone_Prop1->Rotate(rotation_Prop1);
-		Drone_Prop1->Translate(glm::vec3(-0.16, 0.6, 0));
-
-		game::Common *Drone_Prop2 = CreateCommonInstance("Drone_Prop", "Drone_Prop", "TexturedMaterial", "Metal");
-		Drone_Prop2->Scale(glm::vec3(1.0, 1.0, 1.0));
-		glm::quat rotation_Prop2 = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
-		Drone_Prop2->Rotate(rotation_Prop2);
-		rotation_Prop2 = glm::angleAxis(90 * glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
-		Drone_Prop2->Rotate(rotation_Prop2);
-		Drone_Prop2->Translate(glm::vec3(-0.0, 0.6, 0.16));
-		//***************************************************************************************
-		// initial drone's target
-		Drone_Body->setTarget(Drone_Body->GetPosition());
-		Drone_Body->SetSpeed(0.06);
-		//***************************************************************************************
-		Drone_Center->SetParent(Drone_Body);
-		Drone_Prop1->SetParent(Drone_Center);
-		Drone_Prop2->SetParent(Drone_Center);
+		drone_prefab_.Instantiate(&scene_, pos);
 	}
 
 
@@ -532,11 +537,13 @@ namespace game {
 		Common *House = CreateCommonInstance("House", "HenHouse", "TexturedMaterial", "White_House");
 		House->Scale(glm::vec3(10.0, 10.0, 10.0));;
 		House->Translate(pos);
+		House->SetStatic(true);
 		scene_.AddNode(House);
 
 		Common *Roof = CreateCommonInstance("Roof", "ROOF", "TexturedMaterial", "Roof");
 		Roof->Scale(glm::vec3(1.0, 1.0, 1.0));;
 		Roof->Translate(glm::vec3(0.2, 0.75, 0));
+		Roof->SetStatic(true);
 		scene_.AddNode(Roof);
 
 		Roof->SetParent(House);
@@ -547,6 +554,7 @@ namespace game {
 		resman_.CreateTail("Bird_tail", 0.3, 0.2);
 
 		Common *Body = CreateCommonInstance("Body", "Bird_body", "TexturedMaterial", "Wings");
+		Body->SetKind(BirdBodyKind);
 		Body->Scale(glm::vec3(1.5));
 		Body->Translate(pos);
 		Body->Rotate(glm::angleAxis(glm::pi<float>() / 2.0f, glm::vec3(1, 0, 0)));
@@ -557,6 +565,7 @@ namespace game {
 		Head->Translate(glm::vec3(0.285, 0.9, 0.0));
 
 		Common *LWing = CreateCommonInstance("LWing", "Bird_wings", "TexturedMaterial", "Wings");
+		LWing->SetKind(LeftWingKind);
 		LWing->Scale(glm::vec3(1.0, 1.0, 1.0));
 		glm::quat rotation_LWing = glm::angleAxis(-90 * glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
 		LWing->Rotate(rotation_LWing);
@@ -569,6 +578,7 @@ namespace game {
 		LWing->SetOrigin(glm::vec3(0, -0.5, 0));
 
 		Common *LWing_tip = CreateCommonInstance("LWing_tip", "Bird_wings_tip", "TexturedMaterial", "Wings_tip");
+		LWing_tip->SetKind(LeftWingKind);
 		LWing_tip->Scale(glm::vec3(1.0, 1.0, 1.0));
 		LWing_tip->Translate(glm::vec3(0.16, 0.3, 0.0));
 		LWing_tip->SetAngleSpeed(0.01);
@@ -577,6 +587,7 @@ namespace game {
 		LWing_tip->SetOrigin(glm::vec3(0, -0.5, 0));
 
 		Common *RWing = CreateCommonInstance("RWing", "Bird_wings", "TexturedMaterial", "Wings");
+		RWing->SetKind(RightWingKind);
 		RWing->Scale(glm::vec3(1.0, 1.0, 1.0));
 		glm::quat rotation_RWing = glm::angleAxis(-90 * -glm::pi<float>() / 180.0f, glm::vec3(0.0, 0.0, 1.0));
 		RWing->Rotate(rotation_RWing);
@@ -587,6 +598,7 @@ namespace game {
 		RWing->SetOrigin(glm::vec3(0, -0.5, 0));
 
 		Common *RWing_tip = CreateCommonInstance("RWing_tip", "Bird_wings_tip", "TexturedMaterial", "Wings_tip");
+		RWing_tip->SetKind(RightWingKind);
 		RWing_tip->Scale(glm::vec3(1.0, 1.0, 1.0));
 		glm::quat rotation_RWing_Tip = glm::angleAxis(-glm::pi<float>() / 180.0f, glm::vec3(1.0, 0.0, 0.0));
 		//RWing_tip->Rotate(rotation_RWing_Tip);
@@ -608,7 +620,7 @@ namespace game {
 		Tail->Rotate(rotation_Tail);
 		Tail->Translate(glm::vec3(0.0, -0.7, -0.1));
 
-		Body->SetParent(current_camera);
+		Body->SetParent(CurrentCamera());
 		Head->SetParent(Body);
 		LWing->SetParent(Body);
 		RWing->SetParent(Body);
@@ -619,15 +631,26 @@ namespace game {
 
 		// set 
 
-		player = Body;
+		player = scene_.GetRef(Body);
 
 	}
 
 	void Game::resetGame()
 	{
-		std::vector<SceneNode*> list;
-		scene_.SetNodeList(list);
-		SetupScene();
+		initial_scene_.Restore(&scene_, &resman_);
+		FindSceneNodes();
+
+		// The snapshot holds the projections of the start of the game; the
+		// window may have been resized since
+		int width, height;
+		glfwGetFramebufferSize(window_, &width, &height);
+		NodeRef cameras[] = { first_view_camera, third_view_camera, overlook_camera };
+		for (int i = 0; i < 3; i++) {
+			CameraNode *cNode = scene_.ResolveAs<CameraNode>(cameras[i]);
+			if (cNode) {
+				cNode->GetCamera()->SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
+			}
+		}
 		health = 50;
 		energy = 50;
 		num_Drone = 40;
@@ -636,12 +659,22 @@ namespace game {
 		min_Chicken = 25;
 	}
 
+	void Game::FindSceneNodes(void)
+	{
+		first_view_camera = scene_.GetRef(scene_.GetNode("Camera"));
+		third_view_camera = scene_.GetRef(scene_.GetNode("ThirdCamera"));
+		overlook_camera = scene_.GetRef(scene_.GetNode("OverlookCamera"));
+		current_camera = first_view_camera;
+		skybox_ = scene_.GetRef(scene_.GetNode("Skybox"));
+		player = scene_.GetRef(scene_.GetNode("Body"));
+	}
+
 	void Game::SetUpCamera()
 	{
 		// Set viewport
 		int width, height;
 		glfwGetFramebufferSize(window_, &width, &height);
-		glViewport(0, 0, width, height);
+		GLState::Viewport(0, 0, width, height);
 
 		Camera* camera = new Camera();
 		// Set current view
@@ -650,30 +683,33 @@ namespace game {
 		camera->SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
 
 		CameraNode *CNode = new CameraNode(camera, "Camera");
+		CNode->SetKind(FirstCameraKind);
 		CNode->SetFictionFactor(0.005);
 		CNode->SetMaxSpeed(1.0);
 		scene_.AddNode(CNode);
-		current_camera = CNode;
-		first_view_camera = CNode;
+		first_view_camera = scene_.GetRef(CNode);
+		current_camera = first_view_camera;
 
 		// Create third Camera
 		camera = new Camera();
 		// Set current view
-		camera->SetView(camera_position_g + glm::vec3(-2, 6, 10), current_camera->GetPosition(), glm::normalize(glm::vec3(0, 1, 0)));
+		camera->SetView(camera_position_g + glm::vec3(-2, 6, 10), CNode->GetPosition(), glm::normalize(glm::vec3(0, 1, 0)));
 		// Set projection
 		camera->SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
 
 		CameraNode* thirdCamera = new CameraNode(camera, "ThirdCamera");
+		thirdCamera->SetKind(ThirdCameraKind);
 		thirdCamera->SetParent(CNode);
-		third_view_camera = thirdCamera;
+		third_view_camera = scene_.GetRef(thirdCamera);
 
 
 		// Create overlook  camera
 		camera = new Camera();
 		CameraNode* overlookCamera = new CameraNode(camera, "OverlookCamera");
 		camera->SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
-		overlook_camera = overlookCamera;
+		overlookCamera->SetKind(OverlookCameraKind);
 		scene_.AddNode(overlookCamera);
+		overlook_camera = scene_.GetRef(overlookCamera);
 
 	}
 
@@ -687,8 +723,7 @@ namespace game {
 		UIText[2] = resman_.GetResource("Magic_blue")->GetResource();
 		UIText[3] = resman_.GetResource("Black")->GetResource();
 
-		UIvbo = resman_.GetResource("2DSquare")->GetArrayBuffer();
-		UIebo = resman_.GetResource("2DSquare")->GetElementArrayBuffer();
+		UIquad = resman_.GetResource("2DSquare");
 
 	}
 
@@ -700,52 +735,25 @@ namespace game {
 		ScreenText[1] = resman_.GetResource("HappyEnd")->GetResource();
 		ScreenText[2] = resman_.GetResource("SadEnd")->GetResource();
 
-		Screenvbo = resman_.GetResource("2DSquare")->GetArrayBuffer();
-		Screenebo = resman_.GetResource("2DSquare")->GetElementArrayBuffer();
+		Screenquad = resman_.GetResource("2DSquare");
 	}
 
 	void Game::DrawUI() {
 		// Enable z-buffer
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
+		GLState::Enable(GL_DEPTH_TEST);
+		GLState::DepthFunc(GL_LESS);
 
 		// Select proper material (shader program)
-		glUseProgram(UIshader);
+		GLState::UseProgram(UIshader);
 
 		// Set geometry to draw
-		glBindBuffer(GL_ARRAY_BUFFER, UIvbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, UIebo);
+		GLState::BindVertexArray(UIquad->GetVertexArray());
 
-		// Set attributes for 2d camera
-		// Set view matrix in shader
-		GLint view_mat = glGetUniformLocation(UIshader, "view_mat");
+		// Set attributes for 2d camera: identity view and projection
 		glm::mat4 matrix = glm::mat4(1.0f);
-		glUniformMatrix4fv(view_mat, 1, GL_FALSE, glm::value_ptr(matrix));
-
-		// Set projection matrix in shader
-		GLint projection_mat = glGetUniformLocation(UIshader, "projection_mat");
-		glUniformMatrix4fv(projection_mat, 1, GL_FALSE, glm::value_ptr(matrix));
-
-		// Set attributes for shaders
-		GLint vertex_att = glGetAttribLocation(UIshader, "vertex");
-		glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), 0);
-		glEnableVertexAttribArray(vertex_att);
-
-		GLint normal_att = glGetAttribLocation(UIshader, "normal");
-		glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(normal_att);
-
-		GLint color_att = glGetAttribLocation(UIshader, "color");
-		glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(6 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(color_att);
-
-		GLint tex_att = glGetAttribLocation(UIshader, "uv");
-		glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(9 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(tex_att);
+		UniformBlocks::SetFrame(matrix, matrix, glm::vec3(0.0), (float)glfwGetTime());
 
 		glm::mat4 transfMatrix, scalingMatrix, transf;
-		GLint world_mat = glGetUniformLocation(UIshader, "world_mat");
-		GLint tex = glGetUniformLocation(UIshader, "texture_map");
 
 		
 		for (int i = 0; i < 2; i++) {
@@ -754,17 +762,12 @@ namespace game {
 			scalingMatrix = glm::scale(glm::mat4(1.0), glm::vec3(0.15, 0.5, 1));
 			transf = transfMatrix * scalingMatrix;
 
-			glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
+			UniformBlocks::PushObject(transf);
 
-			glUniform1i(tex, 0); // Assign the first texture to the map
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, UIText[i * 2 + 1]);
-			// Define texture interpolation
-			glGenerateMipmap(GL_TEXTURE_2D);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			GLState::BindSampler(0, GLState::GetMipmapSampler());
+			GLState::BindTexture(0, GL_TEXTURE_2D, UIText[i * 2 + 1]);
 
-			glDrawElements(GL_TRIANGLES, 16, GL_UNSIGNED_INT, 0);
+			DrawQuad(UIquad);
 		}
 		
 
@@ -775,17 +778,12 @@ namespace game {
 
 
 		transf = transfMatrix * scalingMatrix;
-		glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
+		UniformBlocks::PushObject(transf);
 
-		glUniform1i(tex, 0); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, UIText[0]);
-		// Define texture interpolation
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::BindSampler(0, GLState::GetMipmapSampler());
+		GLState::BindTexture(0, GL_TEXTURE_2D, UIText[0]);
 
-		glDrawElements(GL_TRIANGLES, 16, GL_UNSIGNED_INT, 0);
+		DrawQuad(UIquad);
 
 
 		transfMatrix = glm::translate(glm::mat4(1.0), glm::vec3(-0.6, 0.5, -0.01));
@@ -793,22 +791,26 @@ namespace game {
 		scalingMatrix = glm::scale(glm::mat4(1.0), glm::vec3(0.15, 0.5*precent, 1));
 		transfMatrix = glm::translate(transfMatrix, glm::vec3(0, -0.25+0.5*precent / 2, 0));
 		transf = transfMatrix * scalingMatrix;
-		glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
+		UniformBlocks::PushObject(transf);
 
-		glUniform1i(tex, 0); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, UIText[2]);
-		// Define texture interpolation
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::BindSampler(0, GLState::GetMipmapSampler());
+		GLState::BindTexture(0, GL_TEXTURE_2D, UIText[2]);
 
-		glDrawElements(GL_TRIANGLES, 16, GL_UNSIGNED_INT, 0);
+		DrawQuad(UIquad);
+		GLState::BindVertexArray(0);
 		
 	}
 
+	void Game::DrawQuad(const Resource *quad) {
+
+		// Meshes are ranges of the geometry arena
+		glDrawElementsBaseVertex(GL_TRIANGLES, quad->GetSize(), quad->GetIndexType(), (const GLvoid *)(quad->GetFirstIndex() * IndexSize(quad->GetIndexType())), quad->GetBaseVertex());
+	}
+
 	void Game::RenderScreen(GameState gs)
 	{
+		// Count the state calls of this frame apart from the last one
+		GLState::BeginFrame();
 
 		// Clear background
 		glClearColor(0,0,0, 0.0);
@@ -833,61 +835,31 @@ namespace game {
 		}
 
 		// Enable z-buffer
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
+		GLState::Enable(GL_DEPTH_TEST);
+		GLState::DepthFunc(GL_LESS);
 
 		// Select proper material (shader program)
-		glUseProgram(Screenshader);
+		GLState::UseProgram(Screenshader);
 
 		// Set geometry to draw
-		glBindBuffer(GL_ARRAY_BUFFER, Screenvbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Screenebo);
+		GLState::BindVertexArray(Screenquad->GetVertexArray());
 
-		// Set attributes for 2d camera
-		// Set view matrix in shader
-		GLint view_mat = glGetUniformLocation(Screenshader, "view_mat");
+		// Set attributes for 2d camera: identity view and projection
 		glm::mat4 matrix = glm::mat4(1.0f);
-		glUniformMatrix4fv(view_mat, 1, GL_FALSE, glm::value_ptr(matrix));
-
-		// Set projection matrix in shader
-		GLint projection_mat = glGetUniformLocation(Screenshader, "projection_mat");
-		glUniformMatrix4fv(projection_mat, 1, GL_FALSE, glm::value_ptr(matrix));
-
-		// Set attributes for shaders
-		GLint vertex_att = glGetAttribLocation(Screenshader, "vertex");
-		glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), 0);
-		glEnableVertexAttribArray(vertex_att);
-
-		GLint normal_att = glGetAttribLocation(Screenshader, "normal");
-		glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(normal_att);
-
-		GLint color_att = glGetAttribLocation(Screenshader, "color");
-		glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(6 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(color_att);
-
-		GLint tex_att = glGetAttribLocation(Screenshader, "uv");
-		glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void *)(9 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(tex_att);
+		UniformBlocks::SetFrame(matrix, matrix, glm::vec3(0.0), (float)glfwGetTime());
 
 		glm::mat4 transfMatrix, scalingMatrix, transf;
-		GLint world_mat = glGetUniformLocation(Screenshader, "world_mat");
-		GLint tex = glGetUniformLocation(Screenshader, "texture_map");
 
 		transfMatrix = glm::mat4(1.0);
 		scalingMatrix = glm::scale(glm::mat4(1.0), glm::vec3(2));
 		transf = transfMatrix * scalingMatrix;
-		glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
+		UniformBlocks::PushObject(transf);
 
-		glUniform1i(tex, 0); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, ScreenText[i]);
-		// Define texture interpolation
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::BindSampler(0, GLState::GetMipmapSampler());
+		GLState::BindTexture(0, GL_TEXTURE_2D, ScreenText[i]);
 
-		glDrawElements(GL_TRIANGLES, 16, GL_UNSIGNED_INT, 0);
+		DrawQuad(Screenquad);
+		GLState::BindVertexArray(0);
 	}
 
 
@@ -898,22 +870,19 @@ namespace game {
 		while (!glfwWindowShouldClose(window_)) {
 
 			// remove distoried object
-			std::vector<SceneNode*>::iterator it;
-			std::vector<SceneNode*> list = scene_.GetNodeList();
+			const std::vector<SceneNode*> &destroyed = scene_.GetDestroyQueue();
 			std::vector<Particle*> pList;
-			for (it = list.begin(); it != list.end();) {
-				if ((*it)->GetShouldBeDestoried()) { 
-					if ((*it)->GetName() == "CK_Body") { num_Chicken -= 1; }
-					if ((*it)->GetName() == "Drone_Body") { 
-						num_Drone -= 1; 
-						pList.push_back(CreateExplosion((*it)->GetPosition()));
-					}
-					it = list.erase(it); 
+			for (size_t d = 0; d < destroyed.size(); d++) {
+				if (destroyed[d]->GetKind() == ChickenKind) { num_Chicken -= 1; }
+				if (destroyed[d]->GetKind() == DroneKind) { 
+					num_Drone -= 1; 
+					pList.push_back(CreateExplosion(destroyed[d]->GetPosition()));
 				}
-				else ++it;
 			}
-			list.insert(list.end(),pList.begin(),pList.end());
-			scene_.SetNodeList(list);
+			scene_.FlushDestroyed();
+			for (size_t p = 0; p < pList.size(); p++) {
+				scene_.AddNode(pList[p]);
+			}
 
 			if (gameStep == Begining || gameStep == HappyEnd || gameStep == SadEnd) {
 				RenderScreen(gameStep);
@@ -938,19 +907,19 @@ namespace game {
 						energy = energy + 0.007 >= 100 ? 100 : energy + 0.007;
 
 						
-						if (first_view_camera->getStun() >= 0.0f) { playerstate = Stun; }
+						if (FirstViewCamera()->getStun() >= 0.0f) { playerstate = Stun; }
 						else { playerstate = Normal; }
 
 
 						if (playerstate == Normal) {
 							// Draw the scene
-							scene_.Draw(current_camera->GetCamera());
+							scene_.Draw(CurrentCamera()->GetCamera());
 							DrawUI();
 						}
 						else if (playerstate == Stun) {
 
 							// Draw the scene to a texture
-							scene_.DrawToTexture(current_camera->GetCamera());
+							scene_.DrawToTexture(CurrentCamera()->GetCamera());
 
 							// Process the texture with a screen-space effect and display the texture
 							scene_.DisplayTexture(resman_.GetResource("ScreenSpaceMaterial")->GetResource(), 4);
@@ -992,6 +961,22 @@ namespace game {
 			glfwSetWindowShouldClose(window, true);
 		}
 
+		// Print the OpenGL state calls of the last frame, and how many the
+		// state cache dropped
+		if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+			std::cout << "state calls: " << GLState::GetIssuedCalls() << " issued, "
+				<< GLState::GetSkippedCalls() << " skipped" << std::endl;
+		}
+
+		// Cycle the ordering of the opaque draws: by state, front to back,
+		// depth pre-pass
+		if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+			static const char *ordering_names[] = { "by state", "front to back", "depth pre-pass" };
+			OpaqueOrdering ordering = (OpaqueOrdering)((game->scene_.GetOpaqueOrdering() + 1) % 3);
+			game->scene_.SetOpaqueOrdering(ordering);
+			std::cout << "opaque ordering: " << ordering_names[ordering] << std::endl;
+		}
+
 		if (game->gameStep == Begining) {
 			if (key == GLFW_KEY_ENTER && action == GLFW_PRESS) {
 				game->gameStep = Playing;
@@ -1022,43 +1007,40 @@ namespace game {
 			if (game->playerstate != Stun) {
 				if (!game->getTornado()) {
 					if (key == GLFW_KEY_UP) {
-						game->first_view_camera->Pitch(rot_factor);
+						game->FirstViewCamera()->Pitch(rot_factor);
 					}
 					if (key == GLFW_KEY_DOWN) {
-						game->first_view_camera->Pitch(-rot_factor);
+						game->FirstViewCamera()->Pitch(-rot_factor);
 					}
 					if (key == GLFW_KEY_LEFT) {
-						game->first_view_camera->Yaw(rot_factor);
+						game->FirstViewCamera()->Yaw(rot_factor);
 					}
 					if (key == GLFW_KEY_RIGHT) {
-						game->first_view_camera->Yaw(-rot_factor);
+						game->FirstViewCamera()->Yaw(-rot_factor);
 					}
 					if (key == GLFW_KEY_S) {
-						game->first_view_camera->Roll(-rot_factor);
+						game->FirstViewCamera()->Roll(-rot_factor);
 					}
 					if (key == GLFW_KEY_X) {
-						game->first_view_camera->Roll(rot_factor);
+						game->FirstViewCamera()->Roll(rot_factor);
 					}
 					if (key == GLFW_KEY_A && action == GLFW_PRESS) {
-						game->first_view_camera->SetAcceleration(0.1);
+						game->FirstViewCamera()->SetAcceleration(0.1);
 					}
 					if (key == GLFW_KEY_A && action == GLFW_RELEASE) {
-						game->first_view_camera->SetAcceleration(0);
+						game->FirstViewCamera()->SetAcceleration(0);
 					}
 					if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
-						game->first_view_camera->SetAcceleration(-0.025);
+						game->FirstViewCamera()->SetAcceleration(-0.025);
 					}
 					if (key == GLFW_KEY_Z && action == GLFW_RELEASE) {
-						game->first_view_camera->SetAcceleration(0);
+						game->FirstViewCamera()->SetAcceleration(0);
 					}
 
 					if (key == GLFW_KEY_TAB && action == GLFW_PRESS) {
 						game->thirdview = game->thirdview == true ? false : true;
 
-						CameraNode * fcNode = (CameraNode *)game->scene_.GetNode("Camera");
-						CameraNode * tcNode = (CameraNode *)game->scene_.GetNode("ThirdCamera");
-
-						game->current_camera = game->thirdview ? tcNode : fcNode;
+						game->current_camera = game->thirdview ? game->third_view_camera : game->first_view_camera;
 					}
 
 					// Fire control
@@ -1108,7 +1090,7 @@ namespace game {
 							glm::vec3 pos = fcNode->GetPosition() + fcNode->GetForward()*1.0f;
 							int result = game->scene_.delicious(pos);
 							std::cout << result << std::endl;
-							if (result < 0) { game->first_view_camera->setStun(90); }
+							if (result < 0) { game->FirstViewCamera()->setStun(90); }
 							else { game->health += result * 3; }
 							game->energy -= 1;
 						}
@@ -1119,19 +1101,19 @@ namespace game {
 						if (game->energy >= 30) {
 							game->setTornado(true);
 
-							game->last_acc = game->first_view_camera->GetAcceleration();
-							game->last_speed = game->first_view_camera->GetSpeed();
-							game->first_view_camera->SetAcceleration(0);
-							game->first_view_camera->SetSpeed(0);
+							game->last_acc = game->FirstViewCamera()->GetAcceleration();
+							game->last_speed = game->FirstViewCamera()->GetSpeed();
+							game->FirstViewCamera()->SetAcceleration(0);
+							game->FirstViewCamera()->SetSpeed(0);
 							game->current_camera = game->overlook_camera;
-							glm::vec3 pos = game->first_view_camera->GetCamera()->GetPosition();
+							glm::vec3 pos = game->FirstViewCamera()->GetCamera()->GetPosition();
 							glm::vec3 newPos = pos + glm::vec3(0, 50, 0);
 							glm::vec3 lookat = glm::vec3(newPos.x, -25, newPos.z);
 							glm::vec3 up = glm::vec3(0, 0, -1);
 
-							game->overlook_camera->GetCamera()->SetView(newPos, lookat, up);
-							game->overlook_camera->GetCamera()->SetLookAt(lookat);
-							game->overlook_camera->SetPosition(newPos);
+							game->OverlookCamera()->GetCamera()->SetView(newPos, lookat, up);
+							game->OverlookCamera()->GetCamera()->SetLookAt(lookat);
+							game->OverlookCamera()->SetPosition(newPos);
 
 							// Create aim object
 							game->CreateAim(glm::vec3(0.0, 0.0, 0.0));
@@ -1150,9 +1132,7 @@ namespace game {
 					glm::vec3 nextPosition = currentPos;
 					if (key == GLFW_KEY_T && action == GLFW_PRESS) {
 
-						CameraNode * fcNode = (CameraNode *)game->scene_.GetNode("Camera");
-						CameraNode * tcNode = (CameraNode *)game->scene_.GetNode("ThirdCamera");
-						game->current_camera = game->thirdview ? tcNode : fcNode;
+						game->current_camera = game->thirdview ? game->third_view_camera : game->first_view_camera;
 
 						game->setTornado(false);
 						aim->SetShouldBeDestoried(true);
@@ -1160,8 +1140,8 @@ namespace game {
 
 						game->scene_.setSuck(aim->GetPosition());
 						game->suckTime = 400.0;
-						game->first_view_camera->SetAcceleration(game->last_acc);
-						game->first_view_camera->SetSpeed(game->last_speed);
+						game->FirstViewCamera()->SetAcceleration(game->last_acc);
+						game->FirstViewCamera()->SetSpeed(game->last_speed);
 
 					}
 					if (key == GLFW_KEY_J) {
@@ -1180,8 +1160,8 @@ namespace game {
 						nextPosition = currentPos;
 					}
 
-					game->overlook_camera->SetPosition(glm::vec3(nextPosition.x, game->overlook_camera->GetPosition().y, nextPosition.z));
-					game->overlook_camera->GetCamera()->SetLookAt(glm::vec3(game->overlook_camera->GetPosition().x, -25, game->overlook_camera->GetPosition().z));
+					game->OverlookCamera()->SetPosition(glm::vec3(nextPosition.x, game->OverlookCamera()->GetPosition().y, nextPosition.z));
+					game->OverlookCamera()->GetCamera()->SetLookAt(glm::vec3(game->OverlookCamera()->GetPosition().x, -25, game->OverlookCamera()->GetPosition().z));
 					aim->SetPosition(nextPosition);
 
 				}
@@ -1196,7 +1176,7 @@ namespace game {
 	void Game::ResizeCallback(GLFWwindow* window, int width, int height) {
 
 		// Set up viewport and camera projection based on new window size
-		glViewport(0, 0, width, height);
+		GLState::Viewport(0, 0, width, height);
 		void* ptr = glfwGetWindowUserPointer(window);
 		Game *game = (Game *)ptr;
 
@@ -1208,6 +1188,11 @@ namespace game {
 
 	Game::~Game() {
 
+		// Free the scene and the resources while the OpenGL context still
+		// exists
+		scene_.ClearNodes();
+		scene_.ClearStatic();
+		resman_.Clear();
 		glfwTerminate();
 	}
 	   
@@ -1244,10 +1229,11 @@ namespace game {
 	{
 
 		Common* missile = CreateCommonInstance("Missile", "Cylinder", "ObjectMaterial");
+		missile->SetKind(MissileKind);
 		missile->SetRenderState(false);
 		missile->SetLifeTime(1.0);
 		missile->SetScale(glm::vec3(0.05, 1, 0.05));
-		missile->SetSpeed(first_view_camera->GetSpeed() + 0.5);
+		missile->SetSpeed(FirstViewCamera()->GetSpeed() + 0.5);
 		CameraNode* cNode = (CameraNode*)scene_.GetNode("Camera");
 		if (dir == 1) {
 			missile->SetPosition(cNode->GetCamera()->GetPosition() + 0.2f*cNode->GetCamera()->GetForward() + 0.8f*cNode->GetCamera()->GetSide());
@@ -19,6 +19,8 @@
 #include "common.h"
 #include "missile.h"
 #include "Particle.h"
+#include "prefab.h"
+#include "scene_snapshot.h"
 
 
 namespace game {
@@ -60,6 +62,8 @@ namespace game {
 		void SetupResources(void);
 		// Set up initial scene
 		void SetupScene(void);
+		// Compile the blueprints of the spawned characters
+		void CompilePrefabs(void);
 		// Create object
 		void CreatHouse(glm::vec3 pos);
 		void CreateBird(glm::vec3 pos);
@@ -107,11 +111,16 @@ namespace game {
 		static void ResizeCallback(GLFWwindow* window, int width, int height);
 
 		// Camera abstraction
-		CameraNode * current_camera;
-		CameraNode * first_view_camera;
-		CameraNode * third_view_camera;
-		CameraNode * overlook_camera;
-		SkyBox * skybox_;
+		// The scene graph owns the nodes; the game only keeps references,
+		// which go stale when the scene is reset
+		NodeRef current_camera;
+		NodeRef first_view_camera;
+		NodeRef third_view_camera;
+		NodeRef overlook_camera;
+		NodeRef skybox_;
+		CameraNode *CurrentCamera(void) const { return scene_.ResolveAs<CameraNode>(current_camera); }
+		CameraNode *FirstViewCamera(void) const { return scene_.ResolveAs<CameraNode>(first_view_camera); }
+		CameraNode *OverlookCamera(void) const { return scene_.ResolveAs<CameraNode>(overlook_camera); }
 		void CreateMissile(int dir);
 		Particle* CreateExplosion(glm::vec3 pos);
 
@@ -126,12 +135,16 @@ namespace game {
 		Particle * CreateParticleInstance(std::string entity_name, std::string object_name, std::string material_name, std::string texture_name = std::string(""), std::string envmap_name = std::string(""));
 
 		void resetGame();
+		// Point the members of the game to the nodes of a restored scene
+		void FindSceneNodes(void);
 		void SetUpCamera();
 
 		void CreateUI();
 		void CreateScreen();
 
 		void DrawUI();
+		// Draw a mesh resource through the vertex array already bound
+		void DrawQuad(const Resource *quad);
 		void RenderScreen(GameState);
 	
 		int view = 1; // first view 1, third view -1
@@ -156,17 +169,23 @@ namespace game {
 		float last_speed;
 		float last_acc;
 
-		Common* player;
+		NodeRef player;
+
+		// Blueprints of the spawned characters, compiled with the resources
+		Prefab chicken_prefab_;
+		Prefab hen_prefab_;
+		Prefab drone_prefab_;
+
+		// Scene as it was right after SetupScene, restored on reset
+		SceneSnapshot initial_scene_;
 
 		GLuint UIshader;
 		GLuint UIText[4];
-		GLuint UIvbo;
-		GLuint UIebo;
+		const Resource *UIquad; // 2D square, in the geometry arena
 
 		GLuint ScreenText[3];
 		GLuint Screenshader;
-		GLuint Screenvbo;
-		GLuint Screenebo;
+		const Resource *Screenquad;
 
 
 		int num_Drone = 40;
@@ -0,0 +1,146 @@
+#include "geometry_arena.h"
+#include "shader_program.h"
+#include "uniform_blocks.h"
+
+namespace game {
+
+std::vector<GeometryArena*> GeometryArena::arenas_;
+
+
+GeometryArena &GeometryArena::Of(const VertexFormat &format) {
+
+	for (size_t i = 0; i < arenas_.size(); i++) {
+		if (&arenas_[i]->format_ == &format) {
+			return *arenas_[i];
+		}
+	}
+	arenas_.push_back(new GeometryArena(format));
+	return *arenas_.back();
+}
+
+
+void GeometryArena::Clear(void) {
+
+	for (size_t i = 0; i < arenas_.size(); i++) {
+		delete arenas_[i];
+	}
+	arenas_.clear();
+}
+
+
+GeometryArena::GeometryArena(const VertexFormat &format) : format_(format) {
+
+	glGenBuffers(1, &array_buffer_);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, array_buffer_);
+	glBufferData(GL_COPY_WRITE_BUFFER, ARENA_VERTEX_CAPACITY, NULL, GL_STATIC_DRAW);
+	vertex_capacity_ = ARENA_VERTEX_CAPACITY;
+	vertex_used_ = 0;
+
+	glGenBuffers(1, &element_array_buffer_);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, element_array_buffer_);
+	glBufferData(GL_COPY_WRITE_BUFFER, ARENA_INDEX_CAPACITY, NULL, GL_STATIC_DRAW);
+	index_capacity_ = ARENA_INDEX_CAPACITY;
+	index_used_ = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glGenVertexArrays(1, &vertex_array_);
+	glBindVertexArray(vertex_array_);
+	glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+	format_.setup();
+	// Object data of every instance, streamed per draw
+	UniformBlocks::SetupObjects();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+GeometryArena::~GeometryArena() {
+
+	glDeleteVertexArrays(1, &vertex_array_);
+	glDeleteBuffers(1, &array_buffer_);
+	glDeleteBuffers(1, &element_array_buffer_);
+}
+
+
+void GeometryArena::Reserve(GLuint buffer, GLsizeiptr &capacity, GLsizeiptr used, GLsizeiptr needed) {
+
+	if (needed <= capacity) {
+		return;
+	}
+	GLsizeiptr new_capacity = capacity;
+	while (new_capacity < needed) {
+		new_capacity *= 2;
+	}
+
+	// Park the used part in a temporary buffer while the storage is replaced
+	GLuint temp;
+	glGenBuffers(1, &temp);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+	glBufferData(GL_COPY_WRITE_BUFFER, used, NULL, GL_STATIC_COPY);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, temp);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_capacity, NULL, GL_STATIC_DRAW);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &temp);
+	capacity = new_capacity;
+}
+
+
+GeometryRange GeometryArena::Add(const GLfloat *vertex, GLsizei vertex_count, const GLuint *face, GLsizei size) {
+
+	GeometryRange range;
+	range.arena = this;
+	range.index_type = IndexType(vertex_count);
+	GLsizeiptr index_size = IndexSize(range.index_type);
+
+	// Indices of a type start at a multiple of their size, so the first one
+	// can be given as a count of them
+	index_used_ = (index_used_ + index_size - 1) / index_size * index_size;
+
+	range.base_vertex = (GLint)(vertex_used_ / format_.stride);
+	range.first_index = (GLuint)(index_used_ / index_size);
+	range.vertex_count = vertex_count;
+	range.size = size;
+
+	std::vector<unsigned char> packed(vertex_count * format_.stride);
+	format_.pack(vertex, vertex_count, packed.data());
+	Reserve(array_buffer_, vertex_capacity_, vertex_used_, vertex_used_ + packed.size());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, array_buffer_);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, vertex_used_, packed.size(), packed.data());
+	vertex_used_ += packed.size();
+
+	PackIndices(face, size, range.index_type, packed);
+	Reserve(element_array_buffer_, index_capacity_, index_used_, index_used_ + packed.size());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, element_array_buffer_);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, index_used_, packed.size(), packed.data());
+	index_used_ += packed.size();
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return range;
+}
+
+
+bool GeometryArena::Owns(GLuint vertex_array) {
+
+	for (size_t i = 0; i < arenas_.size(); i++) {
+		if (arenas_[i]->vertex_array_ == vertex_array) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool GeometryArena::HasMultiDraw(void) {
+
+	return (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+}
+
+} // namespace game
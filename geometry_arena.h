@@ -0,0 +1,67 @@
+#ifndef GEOMETRY_ARENA_H_
+#define GEOMETRY_ARENA_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "resource.h"
+#include "vertex_layout.h"
+
+// Initial capacity of the arena buffers, in bytes; they grow as needed
+#define ARENA_VERTEX_CAPACITY (4 * 1024 * 1024)
+#define ARENA_INDEX_CAPACITY (1024 * 1024)
+
+namespace game {
+
+	// One vertex buffer and one index buffer shared by all meshes of a
+	// vertex layout
+	// Each mesh is a range of both: its indices stay relative to its own
+	// first vertex and are drawn with a base vertex, as 16-bit indices when
+	// the mesh is small enough. With every mesh behind the same vertex
+	// array, draws only differ by their ranges, and runs of draws with the
+	// same material can go out as one multi-draw call
+	class GeometryArena {
+
+	public:
+		// Arena of a vertex layout, created on first use
+		static GeometryArena &Of(const VertexFormat &format);
+		// Free every arena with its buffers and vertex array; ranges handed
+		// out before become invalid. Needs the context still current
+		static void Clear(void);
+
+		// Pack a mesh given in the source layout into the arena
+		GeometryRange Add(const GLfloat *vertex, GLsizei vertex_count, const GLuint *face, GLsizei size);
+
+		GLuint GetVertexArray(void) const { return vertex_array_; }
+		GLuint GetArrayBuffer(void) const { return array_buffer_; }
+		GLuint GetElementArrayBuffer(void) const { return element_array_buffer_; }
+
+		// Whether a vertex array is the one of an arena
+		static bool Owns(GLuint vertex_array);
+
+		// Whether glMultiDrawElementsIndirect with base instances is available
+		static bool HasMultiDraw(void);
+
+	private:
+		// Create the buffers and the vertex array
+		GeometryArena(const VertexFormat &format);
+		~GeometryArena();
+		// Grow a buffer to hold 'needed' bytes, keeping its name (which the
+		// vertex array refers to) and its first 'used' bytes
+		static void Reserve(GLuint buffer, GLsizeiptr &capacity, GLsizeiptr used, GLsizeiptr needed);
+
+		static std::vector<GeometryArena*> arenas_;
+
+		const VertexFormat &format_;
+		GLuint array_buffer_;
+		GLuint element_array_buffer_;
+		GLuint vertex_array_;
+		GLsizeiptr vertex_capacity_, vertex_used_; // bytes
+		GLsizeiptr index_capacity_, index_used_;
+
+	}; // class GeometryArena
+
+} // namespace game
+
+#endif // GEOMETRY_ARENA_H_
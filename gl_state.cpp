@@ -0,0 +1,293 @@
+#include "gl_state.h"
+
+namespace game {
+
+static const GLuint unknown_binding = ~0u;
+
+GLuint GLState::mipmap_sampler_ = 0;
+GLuint GLState::active_unit_ = unknown_binding;
+GLuint GLState::texture_2d_[GL_STATE_TEXTURE_UNITS];
+GLuint GLState::texture_cube_[GL_STATE_TEXTURE_UNITS];
+GLuint GLState::sampler_[GL_STATE_TEXTURE_UNITS];
+GLuint GLState::program_ = unknown_binding;
+GLuint GLState::vertex_array_ = unknown_binding;
+GLuint GLState::array_buffer_ = unknown_binding;
+GLuint GLState::uniform_buffer_ = unknown_binding;
+GLuint GLState::indirect_buffer_ = unknown_binding;
+
+GLenum GLState::depth_test_ = unknown_binding;
+GLenum GLState::blend_ = unknown_binding;
+GLenum GLState::cull_face_ = unknown_binding;
+GLenum GLState::depth_func_ = unknown_binding;
+GLenum GLState::depth_mask_ = unknown_binding;
+GLenum GLState::color_mask_ = unknown_binding;
+GLenum GLState::blend_func_[4] = { unknown_binding, unknown_binding, unknown_binding, unknown_binding };
+GLenum GLState::blend_equation_[2] = { unknown_binding, unknown_binding };
+GLint GLState::viewport_[4];
+bool GLState::viewport_known_ = false;
+
+int GLState::issued_ = 0;
+int GLState::skipped_ = 0;
+int GLState::last_issued_ = 0;
+int GLState::last_skipped_ = 0;
+
+
+void GLState::Init(void) {
+
+	// Mipmaps are generated when textures are loaded, so the filtering
+	// state does not change from one draw to the next
+	// A bound sampler replaces all the sampling state of the texture, so it
+	// clamps like SOIL does for the textures and cube maps it loads
+	glGenSamplers(1, &mipmap_sampler_);
+	glSamplerParameteri(mipmap_sampler_, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glSamplerParameteri(mipmap_sampler_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(mipmap_sampler_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(mipmap_sampler_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(mipmap_sampler_, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	Reset();
+}
+
+
+void GLState::BeginFrame(void) {
+
+	last_issued_ = issued_;
+	last_skipped_ = skipped_;
+	issued_ = 0;
+	skipped_ = 0;
+
+	Reset();
+}
+
+
+void GLState::Reset(void) {
+
+	active_unit_ = unknown_binding;
+	for (int i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+		texture_2d_[i] = unknown_binding;
+		texture_cube_[i] = unknown_binding;
+		sampler_[i] = unknown_binding;
+	}
+	program_ = unknown_binding;
+	vertex_array_ = unknown_binding;
+	array_buffer_ = unknown_binding;
+	uniform_buffer_ = unknown_binding;
+	indirect_buffer_ = unknown_binding;
+}
+
+
+bool GLState::Changed(bool changed) {
+
+	if (changed) {
+		issued_++;
+	}
+	else {
+		skipped_++;
+	}
+	return changed;
+}
+
+
+void GLState::ActiveTexture(GLuint unit) {
+
+	if (Changed(active_unit_ != unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		active_unit_ = unit;
+	}
+}
+
+
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+
+	GLuint *cached = NULL;
+	if (unit < GL_STATE_TEXTURE_UNITS) {
+		if (target == GL_TEXTURE_2D) {
+			cached = &texture_2d_[unit];
+		}
+		else if (target == GL_TEXTURE_CUBE_MAP) {
+			cached = &texture_cube_[unit];
+		}
+	}
+	if (!Changed(!cached || *cached != texture)) {
+		return;
+	}
+
+	ActiveTexture(unit);
+	glBindTexture(target, texture);
+	if (cached) {
+		*cached = texture;
+	}
+}
+
+
+void GLState::BindSampler(GLuint unit, GLuint sampler) {
+
+	if (unit < GL_STATE_TEXTURE_UNITS) {
+		if (!Changed(sampler_[unit] != sampler)) {
+			return;
+		}
+		sampler_[unit] = sampler;
+	}
+	else {
+		issued_++;
+	}
+	glBindSampler(unit, sampler);
+}
+
+
+void GLState::UseProgram(GLuint program) {
+
+	if (Changed(program_ != program)) {
+		glUseProgram(program);
+		program_ = program;
+	}
+}
+
+
+void GLState::BindVertexArray(GLuint vertex_array) {
+
+	if (Changed(vertex_array_ != vertex_array)) {
+		glBindVertexArray(vertex_array);
+		vertex_array_ = vertex_array;
+	}
+}
+
+
+void GLState::BindBuffer(GLenum target, GLuint buffer) {
+
+	GLuint *cached = NULL;
+	if (target == GL_ARRAY_BUFFER) {
+		cached = &array_buffer_;
+	}
+	else if (target == GL_UNIFORM_BUFFER) {
+		cached = &uniform_buffer_;
+	}
+	else if (target == GL_DRAW_INDIRECT_BUFFER) {
+		cached = &indirect_buffer_;
+	}
+	if (!Changed(!cached || *cached != buffer)) {
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	if (cached) {
+		*cached = buffer;
+	}
+}
+
+
+void GLState::SetCapability(GLenum cap, bool enabled) {
+
+	GLenum *cached = NULL;
+	if (cap == GL_DEPTH_TEST) {
+		cached = &depth_test_;
+	}
+	else if (cap == GL_BLEND) {
+		cached = &blend_;
+	}
+	else if (cap == GL_CULL_FACE) {
+		cached = &cull_face_;
+	}
+	GLenum value = enabled ? GL_TRUE : GL_FALSE;
+	if (!Changed(!cached || *cached != value)) {
+		return;
+	}
+
+	if (enabled) {
+		glEnable(cap);
+	}
+	else {
+		glDisable(cap);
+	}
+	if (cached) {
+		*cached = value;
+	}
+}
+
+
+void GLState::Enable(GLenum cap) {
+
+	SetCapability(cap, true);
+}
+
+
+void GLState::Disable(GLenum cap) {
+
+	SetCapability(cap, false);
+}
+
+
+void GLState::DepthFunc(GLenum func) {
+
+	if (Changed(depth_func_ != func)) {
+		glDepthFunc(func);
+		depth_func_ = func;
+	}
+}
+
+
+void GLState::DepthMask(GLboolean mask) {
+
+	if (Changed(depth_mask_ != mask)) {
+		glDepthMask(mask);
+		depth_mask_ = mask;
+	}
+}
+
+
+void GLState::ColorMask(GLboolean mask) {
+
+	if (Changed(color_mask_ != mask)) {
+		glColorMask(mask, mask, mask, mask);
+		color_mask_ = mask;
+	}
+}
+
+
+void GLState::BlendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+
+	if (Changed(blend_func_[0] != src_rgb || blend_func_[1] != dst_rgb || blend_func_[2] != src_alpha || blend_func_[3] != dst_alpha)) {
+		glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+		blend_func_[0] = src_rgb;
+		blend_func_[1] = dst_rgb;
+		blend_func_[2] = src_alpha;
+		blend_func_[3] = dst_alpha;
+	}
+}
+
+
+void GLState::BlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha) {
+
+	if (Changed(blend_equation_[0] != mode_rgb || blend_equation_[1] != mode_alpha)) {
+		glBlendEquationSeparate(mode_rgb, mode_alpha);
+		blend_equation_[0] = mode_rgb;
+		blend_equation_[1] = mode_alpha;
+	}
+}
+
+
+void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+	if (Changed(!viewport_known_ || viewport_[0] != x || viewport_[1] != y || viewport_[2] != width || viewport_[3] != height)) {
+		glViewport(x, y, width, height);
+		viewport_[0] = x;
+		viewport_[1] = y;
+		viewport_[2] = width;
+		viewport_[3] = height;
+		viewport_known_ = true;
+	}
+}
+
+
+void GLState::GetViewport(GLint viewport[4]) {
+
+	if (!viewport_known_) {
+		glGetIntegerv(GL_VIEWPORT, viewport_);
+		viewport_known_ = true;
+	}
+	for (int i = 0; i < 4; i++) {
+		viewport[i] = viewport_[i];
+	}
+}
+
+} // namespace game
@@ -0,0 +1,107 @@
+#ifndef GL_STATE_H_
+#define GL_STATE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Texture units the draw paths use
+#define GL_STATE_TEXTURE_UNITS 4
+
+namespace game {
+
+	// Shadow copy of the OpenGL state the draw paths change
+	// Setting state through this class skips the calls that would not change
+	// it, and counts both the calls issued and the calls skipped. Bindings
+	// are forgotten at the start of every frame, so code that binds objects
+	// directly between frames (resource loading) needs no care; code that
+	// binds directly within a frame must call Reset afterwards
+	class GLState {
+
+	public:
+		// Create the shared sampler objects; needs a current context
+		static void Init(void);
+
+		// Start a frame: keep the call counts of the last one and forget the
+		// cached bindings; called where the drawing of a frame starts, so
+		// that loop iterations drawing nothing leave the counts alone
+		static void BeginFrame(void);
+
+		// Bind a texture/sampler to a texture unit, unless it is already bound
+		static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+		static void BindSampler(GLuint unit, GLuint sampler);
+
+		// Program, vertex array and buffer bindings; only GL_ARRAY_BUFFER,
+		// GL_UNIFORM_BUFFER and GL_DRAW_INDIRECT_BUFFER are cached, other
+		// targets always go through
+		static void UseProgram(GLuint program);
+		static void BindVertexArray(GLuint vertex_array);
+		static void BindBuffer(GLenum target, GLuint buffer);
+
+		// Capabilities: GL_DEPTH_TEST, GL_BLEND and GL_CULL_FACE are cached
+		static void Enable(GLenum cap);
+		static void Disable(GLenum cap);
+
+		// Depth, blend and viewport state
+		static void DepthFunc(GLenum func);
+		static void DepthMask(GLboolean mask);
+		// Color writes, for all channels at once
+		static void ColorMask(GLboolean mask);
+		static void BlendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+		static void BlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha);
+		static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+		// Current viewport, without a round trip to the driver once it is known
+		static void GetViewport(GLint viewport[4]);
+
+		// Forget the cached bindings
+		static void Reset(void);
+
+		// Sampler for mipmapped textures and cube maps: linear within a
+		// mipmap level, nearest level, clamped to the edges
+		static GLuint GetMipmapSampler(void) { return mipmap_sampler_; }
+
+		// State calls issued and skipped during the last complete frame
+		static int GetIssuedCalls(void) { return last_issued_; }
+		static int GetSkippedCalls(void) { return last_skipped_; }
+
+	private:
+		static void ActiveTexture(GLuint unit);
+		static void SetCapability(GLenum cap, bool enabled);
+		// Record a call; returns true when it has to reach the driver
+		static bool Changed(bool changed);
+
+		static GLuint mipmap_sampler_;
+
+		// Cached bindings, ~0 when unknown
+		static GLuint active_unit_;
+		static GLuint texture_2d_[GL_STATE_TEXTURE_UNITS];
+		static GLuint texture_cube_[GL_STATE_TEXTURE_UNITS];
+		static GLuint sampler_[GL_STATE_TEXTURE_UNITS];
+		static GLuint program_;
+		static GLuint vertex_array_;
+		static GLuint array_buffer_;
+		static GLuint uniform_buffer_;
+		static GLuint indirect_buffer_;
+
+		// Cached fixed-function state, ~0 when unknown; kept across frames
+		static GLenum depth_test_;
+		static GLenum blend_;
+		static GLenum cull_face_;
+		static GLenum depth_func_;
+		static GLenum depth_mask_;
+		static GLenum color_mask_;
+		static GLenum blend_func_[4];
+		static GLenum blend_equation_[2];
+		static GLint viewport_[4];
+		static bool viewport_known_;
+
+		// Call counts of the current and of the last frame
+		static int issued_;
+		static int skipped_;
+		static int last_issued_;
+		static int last_skipped_;
+
+	}; // class GLState
+
+} // namespace game
+
+#endif // GL_STATE_H_
@@ -1,6 +1,6 @@
 // Material with no illumination simulation
 
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec4 color_interp;
@@ -1,18 +1,24 @@
 // Material with no illumination simulation
 
-#version 130
+#version 140
 
 // Vertex buffer
 in vec3 vertex;
 in vec3 color;
+in mat4 world_mat; // per instance
+in mat4 normal_mat;
 
-// Uniform (global) buffer
-uniform mat4 world_mat;
-uniform mat4 view_mat;
-uniform mat4 projection_mat;
+// Uniform (global) buffer: per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 
 // Attributes forwarded to the fragment shader
 out vec4 color_interp;
+invariant gl_Position;
 
 
 void main()
@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+#include "vertex_layout.h"
+
+namespace game {
+
+// Score of a vertex for the vertex cache reordering: high when it was used
+// recently and when few of its triangles are left, so that vertices are
+// finished off instead of being left for a later, cache-cold triangle
+static float VertexScore(int cache_position, int remaining) {
+
+	if (remaining == 0) {
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		if (cache_position < 3) {
+			// Vertices of the last triangle: a fixed score, so that the next
+			// triangle is not always picked next to it
+			score = 0.75f;
+		}
+		else {
+			score = powf(1.0f - (cache_position - 3) * (1.0f / (MESH_SCORE_CACHE_SIZE - 3)), 1.5f);
+		}
+	}
+	return score + 2.0f * powf((float)remaining, -0.5f);
+}
+
+
+static glm::vec3 Position(const std::vector<GLfloat> &vertex, GLuint index) {
+
+	const GLfloat *position = &vertex[index * SOURCE_VERTEX_FLOATS];
+	return glm::vec3(position[0], position[1], position[2]);
+}
+
+
+void MeshOptimizer::Optimize(const std::string &name, std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
+
+	GLsizei vertex_count = (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS);
+	if (face.empty()) {
+		return;
+	}
+
+	float before = ComputeAcmr(face, vertex_count);
+	WeldVertices(vertex, face);
+	OptimizeVertexCache(face, vertex_count);
+	OptimizeOverdraw(face, vertex);
+	OptimizeVertexFetch(vertex, face);
+	float after = ComputeAcmr(face, (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS));
+
+	std::cout << name << ": ACMR " << before << " -> " << after << std::endl;
+}
+
+
+void MeshOptimizer::WeldVertices(const std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
+
+	// Sort the vertices by content, so that identical ones are adjacent;
+	// the unused ones left behind are dropped by the vertex fetch stage
+	GLsizei vertex_count = (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS);
+	std::vector<GLuint> sorted(vertex_count);
+	for (GLsizei v = 0; v < vertex_count; v++) {
+		sorted[v] = v;
+	}
+	const GLfloat *data = vertex.data();
+	std::sort(sorted.begin(), sorted.end(), [data](GLuint a, GLuint b) {
+		return memcmp(data + a * SOURCE_VERTEX_FLOATS, data + b * SOURCE_VERTEX_FLOATS, SOURCE_VERTEX_FLOATS * sizeof(GLfloat)) < 0;
+	});
+
+	std::vector<GLuint> remap(vertex_count);
+	for (GLsizei i = 0; i < vertex_count; i++) {
+		bool same = i > 0 && memcmp(data + sorted[i] * SOURCE_VERTEX_FLOATS, data + sorted[i - 1] * SOURCE_VERTEX_FLOATS, SOURCE_VERTEX_FLOATS * sizeof(GLfloat)) == 0;
+		remap[sorted[i]] = same ? remap[sorted[i - 1]] : sorted[i];
+	}
+	for (size_t i = 0; i < face.size(); i++) {
+		face[i] = remap[face[i]];
+	}
+}
+
+
+float MeshOptimizer::ComputeAcmr(const std::vector<GLuint> &face, GLsizei vertex_count, int cache_size) {
+
+	if (face.size() < 3) {
+		return 0.0f;
+	}
+
+	// A vertex is in the cache while fewer than cache_size misses happened
+	// since it was loaded
+	std::vector<int> loaded(vertex_count, -cache_size);
+	int misses = 0;
+	for (size_t i = 0; i < face.size(); i++) {
+		if (misses - loaded[face[i]] >= cache_size) {
+			loaded[face[i]] = misses++;
+		}
+	}
+	return misses / (float)(face.size() / 3);
+}
+
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<GLuint> &face, GLsizei vertex_count) {
+
+	int triangle_count = (int)(face.size() / 3);
+
+	// Triangles of every vertex that are not emitted yet: adjacency[offset[v]]
+	// holds remaining[v] of them
+	std::vector<int> remaining(vertex_count, 0);
+	for (size_t i = 0; i < face.size(); i++) {
+		remaining[face[i]]++;
+	}
+	std::vector<int> offset(vertex_count + 1, 0);
+	for (GLsizei v = 0; v < vertex_count; v++) {
+		offset[v + 1] = offset[v] + remaining[v];
+	}
+	std::vector<int> adjacency(face.size());
+	std::vector<int> fill(offset.begin(), offset.end() - 1);
+	for (size_t i = 0; i < face.size(); i++) {
+		adjacency[fill[face[i]]++] = (int)(i / 3);
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (GLsizei v = 0; v < vertex_count; v++) {
+		vertex_score[v] = VertexScore(-1, remaining[v]);
+	}
+	std::vector<float> triangle_score(triangle_count);
+	for (int t = 0; t < triangle_count; t++) {
+		triangle_score[t] = vertex_score[face[3 * t]] + vertex_score[face[3 * t + 1]] + vertex_score[face[3 * t + 2]];
+	}
+
+	std::vector<unsigned char> emitted(triangle_count, 0);
+	std::vector<GLuint> result;
+	result.reserve(face.size());
+	std::vector<GLuint> cache, next_cache;
+	int cursor = 0;
+	int best = (int)(std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin());
+
+	while ((int)result.size() < 3 * triangle_count) {
+
+		// Without a candidate next to the cache, go on in input order
+		if (best < 0) {
+			while (emitted[cursor]) {
+				cursor++;
+			}
+			best = cursor;
+		}
+
+		emitted[best] = 1;
+		const GLuint *triangle = &face[3 * best];
+		next_cache.clear();
+		for (int k = 0; k < 3; k++) {
+			GLuint v = triangle[k];
+			result.push_back(v);
+
+			// The triangle is no longer pending for its vertices
+			int *pending = &adjacency[offset[v]];
+			for (int j = 0; j < remaining[v]; j++) {
+				if (pending[j] == best) {
+					pending[j] = pending[remaining[v] - 1];
+					remaining[v]--;
+					break;
+				}
+			}
+			if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end()) {
+				next_cache.push_back(v);
+			}
+		}
+
+		// The vertices of the triangle move to the front of the cache
+		size_t front = next_cache.size();
+		for (size_t i = 0; i < cache.size(); i++) {
+			if (std::find(next_cache.begin(), next_cache.begin() + front, cache[i]) == next_cache.begin() + front) {
+				next_cache.push_back(cache[i]);
+			}
+		}
+
+		// Rescore the vertices whose position changed, including the ones
+		// pushed out, and the triangles they still have
+		for (size_t i = 0; i < next_cache.size(); i++) {
+			GLuint v = next_cache[i];
+			cache_position[v] = i < MESH_SCORE_CACHE_SIZE ? (int)i : -1;
+			float score = VertexScore(cache_position[v], remaining[v]);
+			float delta = score - vertex_score[v];
+			vertex_score[v] = score;
+			for (int j = 0; j < remaining[v]; j++) {
+				triangle_score[adjacency[offset[v] + j]] += delta;
+			}
+		}
+		if (next_cache.size() > MESH_SCORE_CACHE_SIZE) {
+			next_cache.resize(MESH_SCORE_CACHE_SIZE);
+		}
+		cache.swap(next_cache);
+
+		// Next triangle: the best one using a vertex of the cache
+		best = -1;
+		float best_score = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++) {
+			GLuint v = cache[i];
+			for (int j = 0; j < remaining[v]; j++) {
+				int t = adjacency[offset[v] + j];
+				if (triangle_score[t] > best_score) {
+					best = t;
+					best_score = triangle_score[t];
+				}
+			}
+		}
+	}
+
+	face.swap(result);
+}
+
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<GLuint> &face, const std::vector<GLfloat> &vertex, float threshold) {
+
+	GLsizei vertex_count = (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS);
+	size_t triangle_count = face.size() / 3;
+	if (triangle_count < 2) {
+		return;
+	}
+
+	// Cut the triangle order into clusters, simulating the cache with a
+	// restart at every cut, as the reordered clusters will see it
+	float target = ComputeAcmr(face, vertex_count) * threshold;
+	std::vector<size_t> cluster_begin;
+	std::vector<int> loaded(vertex_count, -MESH_CACHE_SIZE);
+	int time = 0;
+	int cluster_misses = 0;
+	size_t cluster_size = 0;
+	for (size_t t = 0; t < triangle_count; t++) {
+		int misses = 0;
+		for (int k = 0; k < 3; k++) {
+			if (time - loaded[face[3 * t + k]] >= MESH_CACHE_SIZE) {
+				misses++;
+			}
+		}
+		// Cut where the cache restarts anyway (no vertex shared with the
+		// cache), or where the cluster so far is as good as the whole order
+		bool cut = t == 0 || misses == 3 || cluster_misses <= target * cluster_size;
+		if (cut) {
+			cluster_begin.push_back(t);
+			time += MESH_CACHE_SIZE;
+			cluster_misses = 0;
+			cluster_size = 0;
+		}
+		for (int k = 0; k < 3; k++) {
+			GLuint v = face[3 * t + k];
+			if (time - loaded[v] >= MESH_CACHE_SIZE) {
+				loaded[v] = time++;
+				cluster_misses++;
+			}
+		}
+		cluster_size++;
+	}
+	cluster_begin.push_back(triangle_count);
+	size_t cluster_count = cluster_begin.size() - 1;
+	if (cluster_count < 2) {
+		return;
+	}
+
+	// Area-weighted centroid and normal of every cluster and of the mesh
+	std::vector<glm::vec3> centroid(cluster_count), normal(cluster_count);
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	std::vector<float> area(cluster_count, 0.0f);
+	for (size_t c = 0; c < cluster_count; c++) {
+		centroid[c] = glm::vec3(0.0f);
+		normal[c] = glm::vec3(0.0f);
+		for (size_t t = cluster_begin[c]; t < cluster_begin[c + 1]; t++) {
+			glm::vec3 p0 = Position(vertex, face[3 * t]);
+			glm::vec3 p1 = Position(vertex, face[3 * t + 1]);
+			glm::vec3 p2 = Position(vertex, face[3 * t + 2]);
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float a = glm::length(n);
+			centroid[c] += (p0 + p1 + p2) * (a / 3.0f);
+			normal[c] += n;
+			area[c] += a;
+		}
+		mesh_centroid += centroid[c];
+		mesh_area += area[c];
+		if (area[c] > 0.0f) {
+			centroid[c] /= area[c];
+		}
+	}
+	if (mesh_area > 0.0f) {
+		mesh_centroid /= mesh_area;
+	}
+
+	// Clusters far out along their own normal are the likeliest to hide
+	// others, so they go first
+	std::vector<float> key(cluster_count, 0.0f);
+	std::vector<size_t> order(cluster_count);
+	for (size_t c = 0; c < cluster_count; c++) {
+		if (glm::length(normal[c]) > 0.0f) {
+			key[c] = glm::dot(centroid[c] - mesh_centroid, glm::normalize(normal[c]));
+		}
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) { return key[a] > key[b]; });
+
+	std::vector<GLuint> result;
+	result.reserve(face.size());
+	for (size_t i = 0; i < cluster_count; i++) {
+		size_t c = order[i];
+		result.insert(result.end(), face.begin() + 3 * cluster_begin[c], face.begin() + 3 * cluster_begin[c + 1]);
+	}
+	face.swap(result);
+}
+
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
+
+	const GLuint unused = ~0u;
+	GLsizei vertex_count = (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS);
+	std::vector<GLuint> remap(vertex_count, unused);
+	std::vector<GLfloat> result;
+	result.reserve(vertex.size());
+	GLuint next = 0;
+	for (size_t i = 0; i < face.size(); i++) {
+		GLuint v = face[i];
+		if (remap[v] == unused) {
+			remap[v] = next++;
+			result.insert(result.end(), vertex.begin() + v * SOURCE_VERTEX_FLOATS, vertex.begin() + (v + 1) * SOURCE_VERTEX_FLOATS);
+		}
+		face[i] = remap[v];
+	}
+	vertex.swap(result);
+}
+
+} // namespace game
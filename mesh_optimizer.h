@@ -0,0 +1,60 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Entries of the FIFO post-transform cache the ACMR is measured with
+#define MESH_CACHE_SIZE 16
+// Entries of the LRU cache the vertex cache reordering models
+#define MESH_SCORE_CACHE_SIZE 32
+// How much worse than the cache-optimized order the overdraw order may make
+// the ACMR
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+
+namespace game {
+
+	// Reordering of indexed triangle meshes in the interleaved source layout
+	// (position, normal, color, uv), run on every mesh before it is uploaded
+	// None of the stages changes what is drawn: identical vertices are
+	// merged (loaded meshes repeat them for every triangle), triangles are
+	// sorted for the post-transform vertex cache, then in clusters so that
+	// the outside of the mesh is drawn before what it hides, and the
+	// vertices are finally sorted in the order the triangles use them
+	class MeshOptimizer {
+
+	public:
+		// Run all stages, printing the ACMR before and after as 'name'; every
+		// index must refer to a vertex of the mesh
+		static void Optimize(const std::string &name, std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+
+		// Make the triangles share vertices that are identical in every
+		// attribute
+		static void WeldVertices(const std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+
+		// Average cache miss ratio: vertices transformed per triangle with a
+		// FIFO cache of 'cache_size' entries; 3 without any reuse, 0.5 at best
+		// for large regular grids
+		static float ComputeAcmr(const std::vector<GLuint> &face, GLsizei vertex_count, int cache_size = MESH_CACHE_SIZE);
+
+		// Reorder triangles for the vertex cache (Forsyth's linear-speed
+		// algorithm: greedily emit the triangle whose vertices score best,
+		// favouring recently used vertices and vertices with few triangles left)
+		static void OptimizeVertexCache(std::vector<GLuint> &face, GLsizei vertex_count);
+
+		// Reorder clusters of a cache-optimized triangle order front to back
+		// from the outside of the mesh (Tipsify-style): clusters are cut where
+		// the cache restarts anyway, or where cutting keeps the ACMR within
+		// 'threshold' of the current one
+		static void OptimizeOverdraw(std::vector<GLuint> &face, const std::vector<GLfloat> &vertex, float threshold = MESH_OVERDRAW_THRESHOLD);
+
+		// Sort vertices by first use in the index buffer, dropping unused ones
+		static void OptimizeVertexFetch(std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+
+	}; // class MeshOptimizer
+
+} // namespace game
+
+#endif // MESH_OPTIMIZER_H_
@@ -8,8 +8,13 @@ layout (triangle_strip, max_vertices = 4) out;
 in vec3 vertex_color[];
 in float timestep[];
 
-// Uniform (global) buffer
-uniform mat4 projection_mat;
+// Uniform (global) buffer: per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 
 // Simulation parameters (constants)
 uniform float particle_size = 0.01;
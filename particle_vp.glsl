@@ -4,12 +4,16 @@
 in vec3 vertex;
 in vec3 normal;
 in vec3 color;
+in mat4 world_mat; // per instance
+in mat4 normal_mat;
 
-// Uniform (global) buffer
-uniform mat4 world_mat;
-uniform mat4 view_mat;
-uniform mat4 normal_mat;
-uniform float timer;
+// Uniform (global) buffer: per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 uniform int flag;
 
 // Attributes forwarded to the geometry shader
@@ -0,0 +1,94 @@
+#include <stdexcept>
+
+#include "prefab.h"
+
+namespace game {
+
+Prefab::Prefab(void) {
+}
+
+
+Prefab::~Prefab() {
+}
+
+
+int Prefab::AddPart(const std::string &name, const Resource *geometry, const Resource *material, const Resource *texture, const Resource *envmap, int parent) {
+
+	if (parent >= (int)parts_.size() || (parent < 0 && !parts_.empty())) {
+		throw(std::invalid_argument(std::string("Invalid parent for prefab part ") + name));
+	}
+
+	PrefabPart part;
+	part.name = name;
+	part.geometry = geometry;
+	part.material = material;
+	part.texture = texture;
+	part.envmap = envmap;
+	part.parent = parent;
+	parts_.push_back(part);
+	return (int)parts_.size() - 1;
+}
+
+
+Common *Prefab::Instantiate(SceneGraph *scene, const glm::vec3 &pos) const {
+
+	if (parts_.empty()) {
+		return NULL;
+	}
+
+	std::vector<Common*> nodes(parts_.size());
+	return Build(scene, pos, nodes);
+}
+
+
+void Prefab::Instantiate(SceneGraph *scene, const std::vector<glm::vec3> &positions) const {
+
+	if (parts_.empty() || positions.empty()) {
+		return;
+	}
+
+	int num_listed = 0;
+	for (size_t i = 0; i < parts_.size(); i++) {
+		if (parts_[i].parent < 0 || parts_[i].listed) {
+			num_listed++;
+		}
+	}
+	scene->ReserveNodes((int)(positions.size() * parts_.size()), (int)positions.size() * num_listed);
+
+	std::vector<Common*> nodes(parts_.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		Build(scene, positions[i], nodes);
+	}
+}
+
+
+Common *Prefab::Build(SceneGraph *scene, const glm::vec3 &pos, std::vector<Common*> &nodes) const {
+
+	for (size_t i = 0; i < parts_.size(); i++) {
+		const PrefabPart &part = parts_[i];
+		Common *node = new Common(part.name, part.geometry, part.material, part.texture, part.envmap);
+		node->SetKind(part.kind);
+		node->SetScale(part.scale);
+		node->SetOrientation(part.orientation);
+		node->SetPosition(i == 0 ? part.position + pos : part.position);
+		node->SetOrigin(part.origin);
+		node->SetForward(part.forward);
+		node->SetSpeed(part.speed);
+		node->SetAngleSpeed(part.angle_speed);
+		node->SetRotAxis(part.rot_axis);
+		node->SetRotRange(part.rot_range);
+
+		// Parts come after their parent, so the root is in the scene before
+		// any child is attached
+		if (part.parent >= 0) {
+			node->SetParent(nodes[part.parent]);
+		}
+		if (part.parent < 0 || part.listed) {
+			scene->AddNode(node);
+		}
+		nodes[i] = node;
+	}
+	return nodes[0];
+}
+
+} // namespace game
@@ -0,0 +1,74 @@
+#ifndef PREFAB_H_
+#define PREFAB_H_
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "resource.h"
+#include "common.h"
+#include "scene_graph.h"
+
+namespace game {
+
+	// One node of a prefab, with its resources already resolved
+	struct PrefabPart {
+		std::string name;
+		NodeKind kind = GenericKind;
+		const Resource *geometry = NULL;
+		const Resource *material = NULL;
+		const Resource *texture = NULL;
+		const Resource *envmap = NULL;
+
+		// Local transform
+		glm::vec3 position = glm::vec3(0.0);
+		glm::quat orientation;
+		glm::vec3 scale = glm::vec3(1.0);
+		glm::vec3 origin = glm::vec3(0.0);
+
+		// Movement
+		glm::vec3 forward = glm::vec3(0, 0, -1);
+		float speed = 0;
+
+		// Swinging animation of Common
+		float angle_speed = 0;
+		glm::vec3 rot_axis = glm::vec3(0, 1, 0);
+		float rot_range = 0;
+
+		int parent = -1; // index of the parent part, -1 for the root part
+		bool listed = false; // also added to the root list of the scene graph
+	};
+
+	// Blueprint of a hierarchy of Common nodes
+	// The parts are compiled once; creating an instance only allocates the
+	// nodes and copies the precomputed values, without any resource lookup
+	class Prefab {
+
+	public:
+		Prefab(void);
+		~Prefab();
+
+		// Add a part; parents must be added before their children
+		int AddPart(const std::string &name, const Resource *geometry, const Resource *material, const Resource *texture = NULL, const Resource *envmap = NULL, int parent = -1);
+		PrefabPart &GetPart(int index) { return parts_[index]; }
+		int GetNumParts(void) const { return (int)parts_.size(); }
+
+		// Create an instance with its root part moved by 'pos' and add it to the scene
+		Common *Instantiate(SceneGraph *scene, const glm::vec3 &pos) const;
+		// Create one instance per position; room for the nodes of every
+		// instance is made in the scene once, before the first is created
+		void Instantiate(SceneGraph *scene, const std::vector<glm::vec3> &positions) const;
+
+	private:
+		// Create an instance, with 'nodes' as scratch space indexed like the parts
+		Common *Build(SceneGraph *scene, const glm::vec3 &pos, std::vector<Common*> &nodes) const;
+
+		std::vector<PrefabPart> parts_;
+
+	}; // class Prefab
+
+} // namespace game
+
+#endif // PREFAB_H_
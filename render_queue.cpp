@@ -0,0 +1,275 @@
+#include <algorithm>
+
+#include "render_queue.h"
+#include "uniform_blocks.h"
+#include "gl_state.h"
+#include "geometry_arena.h"
+
+namespace game {
+
+// Opaque order: fewest program, texture and mesh changes first, then front to back
+static bool OpaqueOrder(const DrawItem &a, const DrawItem &b) {
+
+	if (a.program != b.program) return a.program < b.program;
+	if (a.texture != b.texture) return a.texture < b.texture;
+	if (a.envmap != b.envmap) return a.envmap < b.envmap;
+	if (a.vertex_array != b.vertex_array) return a.vertex_array < b.vertex_array;
+	if (a.mode != b.mode) return a.mode < b.mode;
+	if (a.index_type != b.index_type) return a.index_type < b.index_type;
+	if (a.first_index != b.first_index) return a.first_index < b.first_index;
+	if (a.base_vertex != b.base_vertex) return a.base_vertex < b.base_vertex;
+	if (a.size != b.size) return a.size < b.size;
+	return a.depth < b.depth;
+}
+
+
+// Strict front to back, then by state
+static bool FrontToBackOrder(const DrawItem &a, const DrawItem &b) {
+
+	if (a.depth != b.depth) return a.depth < b.depth;
+	return OpaqueOrder(a, b);
+}
+
+
+// Items that can go in the same multi-draw call: same program, textures,
+// vertex array and index type, any mesh
+static bool SameBucket(const DrawItem &a, const DrawItem &b) {
+
+	return a.program == b.program && a.texture == b.texture && a.envmap == b.envmap &&
+		a.vertex_array == b.vertex_array && a.mode == b.mode && a.index_type == b.index_type;
+}
+
+
+// Items that can go in the same instanced draw: same bucket and same mesh
+static bool SameDraw(const DrawItem &a, const DrawItem &b) {
+
+	return SameBucket(a, b) && a.first_index == b.first_index && a.base_vertex == b.base_vertex && a.size == b.size;
+}
+
+
+// Blended order: back to front
+static bool BlendedOrder(const DrawItem &a, const DrawItem &b) {
+
+	return a.depth > b.depth;
+}
+
+
+RenderQueue::RenderQueue(void) : lod_scale_(1.0f), ordering_(DepthPrepass), indirect_buffer_(0), draw_count_(0), culled_count_(0) {
+}
+
+
+void RenderQueue::Begin(Camera *camera) {
+
+	view_ = camera->GetCurrentViewMatrix();
+	glm::mat4 projection = camera->GetProjectionMatrix();
+	frustum_.SetMatrix(projection * view_);
+	lod_scale_ = projection[1][1];
+	culled_count_ = 0;
+	opaque_.clear();
+	background_.clear();
+	blended_.clear();
+}
+
+
+bool RenderQueue::IsVisible(const Bounds &bounds) {
+
+	if (frustum_.Intersects(bounds)) {
+		return true;
+	}
+	culled_count_++;
+	return false;
+}
+
+
+void RenderQueue::Add(SceneNode *node) {
+
+	DrawItem item;
+	item.node = node;
+	item.program = node->material_;
+	item.depth_program = node->depth_material_;
+	item.texture = node->texture_;
+	item.envmap = node->envmap_;
+	item.vertex_array = node->vertex_array_;
+	item.mode = node->mode_;
+	item.size = node->size_;
+	item.base_vertex = node->base_vertex_;
+	item.first_index = node->first_index_;
+	item.index_type = node->index_type_;
+
+	// Depth of the center of the world bounds in view space (the camera
+	// looks down -z); the center of the object bounds maps to it. Static
+	// batches have an identity matrix and bounds already in world space
+	const glm::mat4 &world = node->GetTransFMat();
+	const Bounds &bounds = node->bounds_;
+	glm::vec4 center = world[3];
+	if (!bounds.infinite && !bounds.IsEmpty()) {
+		center = world * glm::vec4(0.5f * (bounds.min + bounds.max), 1.0f);
+	}
+	item.depth = -(view_ * center).z;
+
+	// Level of detail from the projected size of the bounding sphere, as a
+	// fraction of the viewport height
+	const Resource *geometry = node->geometryRes_;
+	if (geometry && geometry->HasLods() && item.depth > 0) {
+		float scale = glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+		float radius = 0.5f * glm::length(bounds.max - bounds.min) * scale;
+		const LodLevel *lod = geometry->SelectLod(radius * lod_scale_ / item.depth);
+		if (lod) {
+			item.vertex_array = lod->vertex_array;
+			item.size = lod->range.size;
+			item.base_vertex = lod->range.base_vertex;
+			item.first_index = lod->range.first_index;
+			item.index_type = lod->range.index_type;
+		}
+	}
+
+	if (node->kind_ == SkyboxKind) {
+		background_.push_back(item);
+	}
+	else if (node->blending_ || node->mode_ == GL_POINTS) {
+		blended_.push_back(item);
+	}
+	else {
+		opaque_.push_back(item);
+	}
+}
+
+
+void RenderQueue::Draw(void) {
+
+	std::sort(opaque_.begin(), opaque_.end(), ordering_ == SortFrontToBack ? FrontToBackOrder : OpaqueOrder);
+	std::sort(blended_.begin(), blended_.end(), BlendedOrder);
+
+	draw_count_ = 0;
+
+	GLState::Enable(GL_DEPTH_TEST);
+	GLState::DepthFunc(GL_LESS);
+	GLState::DepthMask(GL_TRUE);
+
+	if (ordering_ == DepthPrepass) {
+		// Without textures the depth-only items of a program all share a
+		// bucket
+		prepass_.clear();
+		for (size_t i = 0; i < opaque_.size(); i++) {
+			if (opaque_[i].depth_program) {
+				DrawItem item = opaque_[i];
+				item.program = item.depth_program;
+				item.texture = 0;
+				item.envmap = 0;
+				prepass_.push_back(item);
+			}
+		}
+		std::sort(prepass_.begin(), prepass_.end(), OpaqueOrder);
+
+		GLState::ColorMask(GL_FALSE);
+		DrawPass(prepass_, true, false);
+		GLState::ColorMask(GL_TRUE);
+
+		// Visible fragments are the ones at the depth laid down
+		GLState::DepthFunc(GL_LEQUAL);
+	}
+	DrawPass(opaque_, true);
+
+	// The skybox is pushed to the far plane by its shader; drawn after the
+	// opaque items, most of it fails the depth test early
+	GLState::DepthFunc(GL_LEQUAL);
+	DrawPass(background_, false);
+	GLState::DepthFunc(GL_LESS);
+
+	// Blended items and particles test against the scene but do not hide
+	// each other
+	GLState::DepthMask(GL_FALSE);
+	DrawPass(blended_, false);
+	GLState::DepthMask(GL_TRUE);
+
+	GLState::Disable(GL_BLEND);
+	GLState::BindVertexArray(0);
+}
+
+
+void RenderQueue::SetState(const DrawItem &item) {
+
+	if (item.node->blending_) {
+		GLState::Enable(GL_BLEND);
+		GLState::BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::BlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
+	}
+	else {
+		GLState::Disable(GL_BLEND);
+	}
+	GLState::UseProgram(item.program);
+	GLState::BindVertexArray(item.vertex_array);
+}
+
+
+void RenderQueue::UploadCommands(void) {
+
+	if (!indirect_buffer_) {
+		glGenBuffers(1, &indirect_buffer_);
+	}
+	// A fresh store every call, so commands still read by the GPU stay intact
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawCommand), commands_.data(), GL_STREAM_DRAW);
+}
+
+
+void RenderQueue::DrawPass(const std::vector<DrawItem> &items, bool instanced, bool shade) {
+
+	bool multi_draw = instanced && GeometryArena::HasMultiDraw();
+
+	size_t i = 0;
+	while (i < items.size()) {
+		const DrawItem &item = items[i];
+		SceneNode *node = item.node;
+
+		// Gather the run of items drawn with the state of this one: copies of
+		// its mesh, and with multi-draw the other meshes of the arena in its
+		// bucket; each mesh becomes one command, and the run only ends with
+		// the bucket
+		bool batch = instanced && item.mode != GL_POINTS;
+		bool bucket = multi_draw && item.mode == GL_TRIANGLES && GeometryArena::Owns(item.vertex_array);
+		instances_.clear();
+		commands_.clear();
+		size_t end = i;
+		while (end < items.size()) {
+			const DrawItem &next = items[end];
+			bool same_mesh = end > i && SameDraw(items[end - 1], next);
+			if (end > i && !(batch && same_mesh) && !(bucket && SameBucket(item, next))) {
+				break;
+			}
+			if (!same_mesh) {
+				DrawCommand command = { (GLuint)next.size, 0, next.first_index, next.base_vertex, (GLuint)instances_.size() };
+				commands_.push_back(command);
+			}
+			commands_.back().instance_count++;
+			instances_.push_back(next.node->GetTransFMat());
+			end++;
+		}
+
+		SetState(item);
+
+		// Textures (through the binding cache) and the uniforms of the node;
+		// the world matrices of the run are streamed as instance attributes,
+		// where each command finds them from its base instance
+		if (shade) {
+			node->SetupShader(item.program);
+		}
+		UniformBlocks::PushObjects(instances_.data(), (int)instances_.size());
+
+		if (item.mode == GL_POINTS) {
+			glDrawArrays(item.mode, 0, item.size);
+		}
+		else if (commands_.size() > 1) {
+			UploadCommands();
+			glMultiDrawElementsIndirect(item.mode, item.index_type, 0, (GLsizei)commands_.size(), 0);
+		}
+		else {
+			const DrawCommand &command = commands_[0];
+			glDrawElementsInstancedBaseVertex(item.mode, command.count, item.index_type, (const GLvoid *)(command.first_index * IndexSize(item.index_type)), command.instance_count, command.base_vertex);
+		}
+		draw_count_++;
+		i = end;
+	}
+}
+
+} // namespace game
@@ -0,0 +1,114 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "scene_node.h"
+#include "camera.h"
+#include "bounds.h"
+
+namespace game {
+
+	// How the opaque items of a frame are ordered against overdraw
+	typedef enum Ordering {
+		SortByState, // fewest state changes, front to back within equal state
+		SortFrontToBack, // strictly front to back, then by state
+		DepthPrepass // depth of every item laid down first, then shaded by state
+	} OpaqueOrdering;
+
+	// One draw of a scene node, with the state it needs; the geometry is the
+	// level of detail picked for the node
+	struct DrawItem {
+		SceneNode *node;
+		GLuint program;
+		GLuint depth_program; // depth-only variant of program, 0 if none
+		GLuint texture;
+		GLuint envmap;
+		GLuint vertex_array;
+		GLenum mode;
+		GLsizei size;
+		GLint base_vertex;
+		GLuint first_index;
+		GLenum index_type;
+		float depth; // distance along the view direction
+	};
+
+	// Layout of one command of glMultiDrawElementsIndirect
+	struct DrawCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	// Draws of a frame, collected from the scene graph and sorted to keep
+	// state changes low
+	// With the depth pre-pass, opaque items first write their depth with
+	// the depth-only variants of their programs and no color; they are then
+	// shaded with GL_LEQUAL, so each pixel runs the fragment program of its
+	// visible surface only. Items whose program has no variant (it discards
+	// fragments, or its gl_Position is not invariant) are shaded as usual
+	// Opaque items are grouped by program, texture and mesh and drawn front
+	// to back; runs of items sharing all of them (the parts of repeated
+	// prefabs) are drawn with one instanced call, and when multi-draw is
+	// available every mesh of the geometry arena sharing a program and
+	// textures goes out in one indirect call, however many instances the
+	// bucket holds. The background (skybox) follows them, and blended items
+	// and particles come last, back to front, without writing depth
+	class RenderQueue {
+
+	public:
+		RenderQueue(void);
+
+		// Start collecting the draws seen from a camera
+		void Begin(Camera *camera);
+		// Whether world-space bounds are in the view of the camera; counts
+		// the subtrees culled
+		bool IsVisible(const Bounds &bounds);
+		// Queue the draw of a node
+		void Add(SceneNode *node);
+		// Ordering of the opaque items, DepthPrepass by default
+		void SetOpaqueOrdering(OpaqueOrdering ordering) { ordering_ = ordering; }
+		OpaqueOrdering GetOpaqueOrdering(void) const { return ordering_; }
+		// Sort and draw the queued items, leaving depth test on and blending off
+		// State changes go through GLState, which drops the redundant ones
+		void Draw(void);
+
+		int GetItemCount(void) const { return (int)(opaque_.size() + background_.size() + blended_.size()); }
+		// Draw calls issued by the last Draw
+		int GetDrawCount(void) const { return draw_count_; }
+		// Subtrees culled since the last Begin
+		int GetCulledCount(void) const { return culled_count_; }
+
+	private:
+		// With instanced set, consecutive items with the same state are drawn
+		// together; without shade, the textures of the nodes are not bound
+		void DrawPass(const std::vector<DrawItem> &items, bool instanced, bool shade = true);
+		// Upload the commands of the current bucket to the indirect buffer
+		void UploadCommands(void);
+		void SetState(const DrawItem &item);
+
+		glm::mat4 view_; // view matrix of the camera of the frame
+		Frustum frustum_; // view volume of the camera of the frame
+		float lod_scale_; // projected size of a unit sphere at unit distance
+
+		OpaqueOrdering ordering_;
+		std::vector<DrawItem> opaque_;
+		std::vector<DrawItem> prepass_; // depth-only copies of opaque items
+		std::vector<DrawItem> background_;
+		std::vector<DrawItem> blended_;
+		std::vector<glm::mat4> instances_; // world matrices of the current run
+		std::vector<DrawCommand> commands_; // meshes of the current run
+		GLuint indirect_buffer_; // created on first use
+
+		int draw_count_; // draw calls of the last frame
+		int culled_count_;
+
+	}; // class RenderQueue
+
+} // namespace game
+
+#endif // RENDER_QUEUE_H_
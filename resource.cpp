@@ -8,16 +8,40 @@ Resource::Resource(ResourceType type, std::string name, GLuint resource, GLsizei
     type_ = type;
     name_ = name;
     resource_ = resource;
+    vertex_array_ = 0;
+    depth_program_ = 0;
     size_ = size;
+    range_.arena = NULL;
+    range_.base_vertex = 0;
+    range_.first_index = 0;
+    range_.vertex_count = 0;
+    range_.size = size;
+    range_.index_type = GL_UNSIGNED_INT;
 }
 
 
-Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, GLuint vertex_array, const Bounds &bounds){
     type_ = type;
     name_ = name;
     array_buffer_ = array_buffer;
     element_array_buffer_ = element_array_buffer;
+    vertex_array_ = vertex_array;
+    depth_program_ = 0;
     size_ = size;
+    range_.arena = NULL;
+    range_.base_vertex = 0;
+    range_.first_index = 0;
+    range_.vertex_count = 0;
+    range_.size = size;
+    range_.index_type = GL_UNSIGNED_INT;
+    bounds_ = bounds;
+}
+
+
+void Resource::SetRange(const GeometryRange &range) {
+
+    range_ = range;
+    size_ = range.size;
 }
 
 
@@ -56,9 +80,47 @@ GLuint Resource::GetElementArrayBuffer(void) const {
 }
 
 
+GLuint Resource::GetVertexArray(void) const {
+
+    return vertex_array_;
+}
+
+
 GLsizei Resource::GetSize(void) const {
 
     return size_;
 }
 
+
+const Bounds &Resource::GetBounds(void) const {
+
+    return bounds_;
+}
+
+
+void Resource::SetSource(std::vector<GLfloat> vertex, std::vector<GLuint> face) {
+
+    source_vertices_.swap(vertex);
+    source_faces_.swap(face);
+}
+
+
+void Resource::AddLod(const LodLevel &lod) {
+
+    lods_.push_back(lod);
+}
+
+
+const LodLevel *Resource::SelectLod(float screen_size) const {
+
+    const LodLevel *selected = NULL;
+    for (size_t i = 0; i < lods_.size(); i++) {
+        if (screen_size > lods_[i].max_screen_size) {
+            break;
+        }
+        selected = &lods_[i];
+    }
+    return selected;
+}
+
 } // namespace game
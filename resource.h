@@ -2,15 +2,41 @@
 #define RESOURCE_H_
 
 #include <string>
+#include <vector>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "bounds.h"
+
+// Levels of detail of procedural geometry, the full-detail one included
+#define NUM_LOD_LEVELS 3
+
 namespace game {
 
+    class GeometryArena;
+
     // Possible resource types
 	typedef enum Type { Material, PointSet, Mesh, Texture, CubeMap } ResourceType;
 
+    // Range of a mesh inside the shared geometry buffers
+    struct GeometryRange {
+        GeometryArena *arena; // NULL for geometry in its own buffers
+        GLint base_vertex; // added to every index of the mesh
+        GLuint first_index; // in indices of index_type
+        GLsizei vertex_count;
+        GLsizei size; // number of indices
+        GLenum index_type;
+    };
+
+    // Coarser version of a geometry resource, drawn when the object covers
+    // at most max_screen_size of the viewport height
+    struct LodLevel {
+        GLuint vertex_array;
+        GeometryRange range;
+        float max_screen_size;
+    };
+
     // Class that holds one resource
     class Resource {
 
@@ -26,18 +52,53 @@ namespace game {
                     GLuint element_array_buffer_;
                 };
             };
+            GLuint vertex_array_; // Vertex layout of geometry, 0 for other resources
+            GLuint depth_program_; // Depth-only variant of a material, 0 if none
             GLsizei size_; // Number of primitives in geometry
+            GeometryRange range_; // Range of geometry in its buffers
+            Bounds bounds_; // Object-space bounds of geometry
+            std::vector<LodLevel> lods_; // Coarser levels, by decreasing screen size
+            // Unpacked copy of the mesh (interleaved layout, indices
+            // relative to the first vertex), for baking it on the CPU
+            std::vector<GLfloat> source_vertices_;
+            std::vector<GLuint> source_faces_;
 
         public:
             Resource(ResourceType type, std::string name, GLuint resource, GLsizei size);
-            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size, GLuint vertex_array = 0, const Bounds &bounds = Bounds());
             ~Resource();
             ResourceType GetType(void) const;
             const std::string GetName(void) const;
             GLuint GetResource(void) const;
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
+            GLuint GetVertexArray(void) const;
+            // Program writing the same depth as a material without shading,
+            // 0 if the material cannot have one
+            GLuint GetDepthProgram(void) const { return depth_program_; }
+            void SetDepthProgram(GLuint program) { depth_program_ = program; }
             GLsizei GetSize(void) const;
+            GLint GetBaseVertex(void) const { return range_.base_vertex; }
+            GLuint GetFirstIndex(void) const { return range_.first_index; }
+            GLsizei GetVertexCount(void) const { return range_.vertex_count; }
+            GLenum GetIndexType(void) const { return range_.index_type; }
+            const GeometryRange &GetRange(void) const { return range_; }
+            // Place the geometry in a range of shared buffers
+            void SetRange(const GeometryRange &range);
+            const Bounds &GetBounds(void) const;
+
+            // Source data of a mesh, in the interleaved layout its range was
+            // packed from
+            void SetSource(std::vector<GLfloat> vertex, std::vector<GLuint> face);
+            const std::vector<GLfloat> &GetSourceVertices(void) const { return source_vertices_; }
+            const std::vector<GLuint> &GetSourceFaces(void) const { return source_faces_; }
+
+            // Levels of detail; the resource itself is the full-detail level
+            void AddLod(const LodLevel &lod);
+            bool HasLods(void) const { return !lods_.empty(); }
+            // Coarsest level allowed at a projected screen size, NULL for
+            // the full-detail level
+            const LodLevel *SelectLod(float screen_size) const;
 
     }; // class Resource
 
@@ -7,15 +7,37 @@
 #include <SOIL/SOIL.h>
 
 #include "resource_manager.h"
+#include "shader_program.h"
+#include "gl_state.h"
+#include "uniform_blocks.h"
+#include "geometry_arena.h"
+#include "mesh_optimizer.h"
 #include "model_loader.h"
 
 namespace game {
 
+// Largest projected size (fraction of the viewport height) at which each
+// level of detail is drawn; level 0 has no limit
+static const float lod_screen_size_g[NUM_LOD_LEVELS] = { 0.0f, 0.12f, 0.04f };
+
+
 ResourceManager::ResourceManager(void){
 }
 
 
 ResourceManager::~ResourceManager(){
+
+    Clear();
+}
+
+
+void ResourceManager::Clear(void){
+
+    for (size_t i = 0; i < resource_.size(); i++){
+        delete resource_[i];
+    }
+    resource_.clear();
+    GeometryArena::Clear();
 }
 
 
@@ -33,12 +55,107 @@ void ResourceManager::AddResource(ResourceType type, const std::string name, GLu
 
     Resource *res;
 
-    res = new Resource(type, name, array_buffer, element_array_buffer, size);
+    // Point sets keep their own buffers and vertex array; meshes go
+    // through AddMesh
+    GLuint vertex_array = 0;
+    if (type == PointSet) {
+        vertex_array = CreateVertexArray(array_buffer, element_array_buffer);
+    }
+    // Particles are moved by their shader, so their extent is unknown here
+    res = new Resource(type, name, array_buffer, element_array_buffer, size, vertex_array, Bounds::Infinite());
 
     resource_.push_back(res);
 }
 
 
+void ResourceManager::AddMesh(const std::string name, std::vector<GLfloat> vertex, std::vector<GLuint> face){
+
+    Resource *res;
+
+    // Meshes are packed into the geometry arena of their layout and share
+    // its vertex array
+    Bounds bounds;
+    GeometryRange range = PackMesh(name, vertex, face, bounds);
+    res = new Resource(Mesh, name, range.arena->GetArrayBuffer(), range.arena->GetElementArrayBuffer(), range.size, range.arena->GetVertexArray(), bounds);
+    res->SetRange(range);
+    // Static batches are baked from the source, never from the arena
+    res->SetSource(std::move(vertex), std::move(face));
+
+    resource_.push_back(res);
+}
+
+
+GLuint ResourceManager::CreateVertexArray(GLuint array_buffer, GLuint element_array_buffer) {
+
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+	SourceVertex::Setup();
+	UniformBlocks::SetupObjects();
+	if (element_array_buffer) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+	}
+
+	// Unbind first, so that later buffer bindings do not change the layout
+	glBindVertexArray(0);
+	return vao;
+}
+
+
+Bounds ResourceManager::ComputeBounds(const GLfloat *vertex, GLsizei vertex_count) {
+
+	Bounds bounds;
+	for (GLsizei i = 0; i < vertex_count; i++) {
+		const GLfloat *position = vertex + i * SOURCE_VERTEX_FLOATS;
+		bounds.Extend(glm::vec3(position[0], position[1], position[2]));
+	}
+	return bounds;
+}
+
+
+GeometryRange ResourceManager::PackMesh(const std::string &name, std::vector<GLfloat> &vertex, std::vector<GLuint> &face, Bounds &bounds) {
+
+	// Reorder for the vertex cache, overdraw and vertex fetch
+	MeshOptimizer::Optimize(name, vertex, face);
+	GLsizei vertex_count = (GLsizei)(vertex.size() / SOURCE_VERTEX_FLOATS);
+
+	// Bounds for culling
+	bounds = ComputeBounds(vertex.data(), vertex_count);
+	GeometryArena &arena = GeometryArena::Of(PackedFormat(vertex.data(), vertex_count));
+	return arena.Add(vertex.data(), vertex_count, face.data(), (GLsizei)face.size());
+}
+
+
+int ResourceManager::LodSamples(int samples, int level, int min_samples) {
+
+	// Halve the sampling at every level, down to a minimum
+	int reduced = (samples + (1 << level) - 1) >> level;
+	return reduced < min_samples ? (samples < min_samples ? samples : min_samples) : reduced;
+}
+
+
+void ResourceManager::AddLevel(const std::string name, int level, std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
+
+	if (level == 0) {
+		AddMesh(name, std::move(vertex), std::move(face));
+		return;
+	}
+
+	// Coarser levels hang from the full-detail resource, added just before
+	Resource *res = resource_.back();
+	LodLevel lod;
+	Bounds bounds;
+	std::ostringstream lod_name;
+	lod_name << name << " (level " << level << ")";
+	lod.range = PackMesh(lod_name.str(), vertex, face, bounds);
+	lod.vertex_array = lod.range.arena->GetVertexArray();
+	lod.max_screen_size = lod_screen_size_g[level];
+	res->AddLod(lod);
+}
+
+
 void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename) {
 
 	// Call appropriate method depending on type of resource
@@ -142,15 +259,72 @@ void ResourceManager::LoadMaterial(const std::string name, const char *prefix) {
 
 	// Create a shader program linking both vertex and fragment shaders
 	// together
+	GLuint sp = LinkProgram(vs, fs, geometry_program ? gs : 0);
+
+	// Materials that keep all their fragments get a depth-only variant for
+	// the depth pre-pass. It links the same vertex shader, and the depth
+	// only matches across the two programs when that shader declares its
+	// gl_Position invariant
+	GLuint depth_sp = 0;
+	if (!geometry_program && fp.find("discard") == std::string::npos && vp.find("invariant gl_Position") != std::string::npos) {
+		std::string directory(prefix);
+		size_t slash = directory.find_last_of("/\\");
+		directory = slash == std::string::npos ? std::string(".") : directory.substr(0, slash);
+		filename = directory + std::string("/depth") + std::string(FRAGMENT_PROGRAM_EXTENSION);
+		std::string depth_fp = LoadTextFile(filename.c_str());
+
+		GLuint depth_fs = glCreateShader(GL_FRAGMENT_SHADER);
+		const char *source_depth_fp = depth_fp.c_str();
+		glShaderSource(depth_fs, 1, &source_depth_fp, NULL);
+		glCompileShader(depth_fs);
+		glGetShaderiv(depth_fs, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			char buffer[512];
+			glGetShaderInfoLog(depth_fs, 512, NULL, buffer);
+			throw(std::ios_base::failure(std::string("Error compiling depth fragment shader: ") + std::string(buffer)));
+		}
+
+		depth_sp = LinkProgram(vs, depth_fs, 0);
+		glDeleteShader(depth_fs);
+		// Uniforms may have initializers in the fragment program of the
+		// material (the "Flag" of the textured material does)
+		ShaderProgram::CopyUniforms(sp, depth_sp);
+	}
+
+	// Delete memory used by shaders, since they were already compiled
+	// and linked
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	if (geometry_program) {
+		glDeleteShader(gs);
+	}
+
+	// Add a resource for the shader program
+	AddResource(Material, name, sp, 0);
+	resource_.back()->SetDepthProgram(depth_sp);
+}
+
+
+GLuint ResourceManager::LinkProgram(GLuint vs, GLuint fs, GLuint gs) {
+
 	GLuint sp = glCreateProgram();
 	glAttachShader(sp, vs);
 	glAttachShader(sp, fs);
-	if (geometry_program) {
+	if (gs) {
 		glAttachShader(sp, gs);
 	}
+	// Fixed attribute locations let any program draw any vertex array
+	glBindAttribLocation(sp, VERTEX_ATTRIB, "vertex");
+	glBindAttribLocation(sp, VERTEX_ATTRIB, "position");
+	glBindAttribLocation(sp, NORMAL_ATTRIB, "normal");
+	glBindAttribLocation(sp, COLOR_ATTRIB, "color");
+	glBindAttribLocation(sp, UV_ATTRIB, "uv");
+	glBindAttribLocation(sp, WORLD_MAT_ATTRIB, "world_mat");
+	glBindAttribLocation(sp, NORMAL_MAT_ATTRIB, "normal_mat");
 	glLinkProgram(sp);
 
 	// Check if shaders were linked successfully
+	GLint status;
 	glGetProgramiv(sp, GL_LINK_STATUS, &status);
 	if (status != GL_TRUE) {
 		char buffer[512];
@@ -158,16 +332,10 @@ void ResourceManager::LoadMaterial(const std::string name, const char *prefix) {
 		throw(std::ios_base::failure(std::string("Error linking shaders: ") + std::string(buffer)));
 	}
 
-	// Delete memory used by shaders, since they were already compiled
-	// and linked
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if (geometry_program) {
-		glDeleteShader(gs);
-	}
-
-	// Add a resource for the shader program
-	AddResource(Material, name, sp, 0);
+	// Query the inputs of the program once, for the draw paths to reuse
+	ShaderProgram::Register(sp);
+	UniformBlocks::BindProgram(sp);
+	return sp;
 }
 
 void ResourceManager::CreateSphereParticles(std::string object_name, int num_particles) {
@@ -264,6 +432,12 @@ void ResourceManager::LoadTexture(const std::string name, const char *filename)
 		throw(std::ios_base::failure(std::string("Error loading texture ") + std::string(filename) + std::string(": ") + std::string(SOIL_last_result())));
 	}
 
+	// Build the mipmaps once; draws only bind the texture
+	// SOIL bound the texture behind the back of the binding cache
+	GLState::Reset();
+	GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
 	// Create resource
 	AddResource(Texture, name, texture, 0);
 }
@@ -460,7 +634,7 @@ void ResourceManager::LoadMesh(const std::string name, const char *filename) {
 
 	// If we got to this point, the file was parsed successfully and the
 	// mesh is in memory
-	// Now, transfer the mesh to OpenGL buffers
+	// Now, flatten the mesh into the interleaved layout
 	// Create three new vertices for each face, in case vertex
 	// normals/texture coordinates are not consistent over the mesh
 
@@ -468,21 +642,13 @@ void ResourceManager::LoadMesh(const std::string name, const char *filename) {
 	const int vertex_att = 11;
 	const int face_att = 3;
 
-	// Create OpenGL buffers and copy data
-	GLuint vbo, ebo;
-
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, mesh.face.size() * 3 * vertex_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.face.size() * face_att * sizeof(GLuint), 0, GL_STATIC_DRAW);
+	std::vector<GLfloat> vertex(mesh.face.size() * 3 * vertex_att, 0.0f);
+	std::vector<GLuint> face(mesh.face.size() * face_att);
 
 	unsigned int vertex_index = 0;
 	for (unsigned int i = 0; i < mesh.face.size(); i++) {
 		// Add three vertices and their attributes
-		GLfloat att[3 * vertex_att] = { 0 };
+		GLfloat *att = &vertex[i * 3 * vertex_att];
 		for (int j = 0; j < 3; j++) {
 			// Position
 			att[j*vertex_att + 0] = mesh.position[mesh.face[i].i[j]][0];
@@ -509,21 +675,15 @@ void ResourceManager::LoadMesh(const std::string name, const char *filename) {
 			}
 		}
 
-		// Copy attributes to buffer
-		glBufferSubData(GL_ARRAY_BUFFER, i * 3 * vertex_att * sizeof(GLfloat), 3 * vertex_att * sizeof(GLfloat), att);
-
 		// Add triangle
-		GLuint findex[face_att] = { 0 };
-		findex[0] = vertex_index;
-		findex[1] = vertex_index + 1;
-		findex[2] = vertex_index + 2;
+		face[i * face_att + 0] = vertex_index;
+		face[i * face_att + 1] = vertex_index + 1;
+		face[i * face_att + 2] = vertex_index + 2;
 		vertex_index += 3;
-
-		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, i * face_att * sizeof(GLuint), face_att * sizeof(GLuint), findex);
 	}
 
 	// Create resource
-	AddResource(Mesh, name, vbo, ebo, mesh.face.size() * face_att);
+	AddMesh(name, std::move(vertex), std::move(face));
 }
 void ResourceManager::LoadCubeMap(const std::string name, const char *filename) {
 
@@ -547,6 +707,12 @@ void ResourceManager::LoadCubeMap(const std::string name, const char *filename)
 		throw(std::ios_base::failure(std::string("Error loading cube map ") + std::string(base) + std::string("<spec>.") + std::string(ext) + std::string(": ") + std::string(SOIL_last_result())));
 	}
 
+	// Build the mipmaps once; draws only bind the texture
+	// SOIL bound the texture behind the back of the binding cache
+	GLState::Reset();
+	GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, texture);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
 	// Create resource
 	AddResource(CubeMap, name, texture, 0);
 }
@@ -616,18 +782,8 @@ void ResourceManager::CreateCube(std::string object_name) {
 		20, 22, 23,
 	};
 
-	// Create OpenGL buffers and copy data
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertex), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(face), face, GL_STATIC_DRAW);
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, sizeof(face) / sizeof(GLfloat));
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 void ResourceManager::Create2Dsquare(std::string object_name)
@@ -647,23 +803,25 @@ void ResourceManager::Create2Dsquare(std::string object_name)
 		0,2,3,
 	};
 
-	
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 11 * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * sizeof(GLuint), face, GL_STATIC_DRAW);
-	
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, 2 * 3);
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 	
 }
 
 
 void ResourceManager::CreateSphere(std::string object_name, float radius_x, float radius_y, float radius_z, int num_samples_theta, int num_samples_phi) {
+
+	// Full detail first, then coarser levels for distant objects
+	for (int level = 0; level < NUM_LOD_LEVELS; level++) {
+		std::vector<GLfloat> vertex;
+		std::vector<GLuint> face;
+		BuildSphere(radius_x, radius_y, radius_z, LodSamples(num_samples_theta, level, 8), LodSamples(num_samples_phi, level, 6), vertex, face);
+		AddLevel(object_name, level, vertex, face);
+	}
+}
+
+
+void ResourceManager::BuildSphere(float radius_x, float radius_y, float radius_z, int num_samples_theta, int num_samples_phi, std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
 	// Create a sphere using a well-known parameterization
 
 	// Number of vertices and faces to be created
@@ -674,18 +832,9 @@ void ResourceManager::CreateSphere(std::string object_name, float radius_x, floa
 	const int vertex_att = 11;
 	const int face_att = 3;
 
-	// Data buffers 
-	GLfloat *vertex = NULL;
-	GLuint *face = NULL;
-
-	// Allocate memory for buffers
-	try {
-		vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-		face = new GLuint[face_num * face_att]; // 3 indices per face
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
+	// Data buffers
+	vertex.assign(vertex_num * vertex_att, 0.0f); // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
+	face.assign(face_num * face_att, 0); // 3 indices per face
 
 	// Create vertices 
 	float theta, phi; // Angles for parametric equation
@@ -740,27 +889,6 @@ void ResourceManager::CreateSphere(std::string object_name, float radius_x, floa
 			}
 		}
 	}
-
-	// Create OpenGL buffers and copy data
-	//GLuint vao;
-	//glGenVertexArrays(1, &vao);
-	//glBindVertexArray(vao);
-
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-	// Free data buffers
-	delete[] vertex;
-	delete[] face;
-
-	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
 }
 
 
@@ -772,16 +900,8 @@ void ResourceManager::CreateMirror(std::string object_name)
 	int face_num = segment_num;
 	int face_att = 3;
 
-	GLfloat *vertex = NULL;
-	GLuint *face = NULL;
-
-	try {
-		vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-		face = new GLuint[face_num * face_att]; // 3 indices per face
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
+	std::vector<GLfloat> vertex(vertex_num * vertex_att); // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
+	std::vector<GLuint> face(face_num * face_att); // 3 indices per face
 
 	float theta = 2.0*glm::pi<GLfloat>() / (segment_num-1);
 
@@ -837,31 +957,14 @@ void ResourceManager::CreateMirror(std::string object_name)
 		}
 	}
 
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-	// Free data buffers
-	delete[] vertex;
-	delete[] face;
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+	AddMesh(object_name, std::move(vertex), std::move(face));
 
 }
 
 void ResourceManager::CreatePyramid(std::string object_name, float bot, float top, float height) {
 
 
-	// Number of attributes for vertices and faces
-	const int vertex_att = 11;
-	const int face_att = 3;
-
 	float half_thick = bot / 2;
 	float top_x = (bot - top) / 2;
 	float bot_uv = bot / (2 * height + top);
@@ -900,28 +1003,14 @@ void ResourceManager::CreatePyramid(std::string object_name, float bot, float to
 	};
 
 
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 8 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 12 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, 12 * face_att);
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 // Bird big wingsq
 void ResourceManager::CreateTrape(std::string object_name, float thick, float bot, float top, float height) {
 
 
-	// Number of attributes for vertices and faces
-	const int vertex_att = 11;
-	const int face_att = 3;
-
 	float half_thick = thick / 2;
 
 	// Data buffers 
@@ -956,18 +1045,8 @@ void ResourceManager::CreateTrape(std::string object_name, float thick, float bo
 	};
 
 
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 8 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 12 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, 12 * face_att);
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 
@@ -975,10 +1054,6 @@ void ResourceManager::CreateTrape(std::string object_name, float thick, float bo
 void ResourceManager::CreateTriangle(std::string object_name, float thick, float bot, float top, float height, bool tip) {
 
 
-	// Number of attributes for vertices and faces
-	const int vertex_att = 11;
-	const int face_att = 3;
-
 	float half_thick = thick / 2;
 
 	float tip_orNot = 0;
@@ -1021,26 +1096,12 @@ void ResourceManager::CreateTriangle(std::string object_name, float thick, float
 	};
 
 
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 8 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 12 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, 12 * face_att);
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 void ResourceManager::CreateTail(const std::string object_name, float tail_diff, float thick) {
 
-	// Number of attributes for vertices and faces
-	const int vertex_att = 11;
-	const int face_att = 3;
-
 	float half_thick = thick / 2;
 
 	// Data buffers 
@@ -1069,22 +1130,24 @@ void ResourceManager::CreateTail(const std::string object_name, float tail_diff,
 	};
 
 
-	GLuint vbo, ebo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 6 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 8 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
 	// Create resource
-	AddResource(Mesh, object_name, vbo, ebo, 12 * face_att);
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples){
 
+    // Full detail first, then coarser levels for distant objects
+    for (int level = 0; level < NUM_LOD_LEVELS; level++) {
+        std::vector<GLfloat> vertex;
+        std::vector<GLuint> face;
+        BuildTorus(loop_radius, circle_radius, LodSamples(num_loop_samples, level, 8), LodSamples(num_circle_samples, level, 6), vertex, face);
+        AddLevel(object_name, level, vertex, face);
+    }
+}
+
+
+void ResourceManager::BuildTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples, std::vector<GLfloat> &vertex, std::vector<GLuint> &face){
+
     // Create a torus
     // The torus is built from a large loop with small circles around the loop
 
@@ -1098,18 +1161,9 @@ void ResourceManager::CreateTorus(std::string object_name, float loop_radius, fl
     const int vertex_att = 11;
     const int face_att = 3;
 
-    // Data buffers for the torus
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
+    // Data buffers
+    vertex.assign(vertex_num * vertex_att, 0.0f); // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
+    face.assign(face_num * face_att, 0); // 3 indices per face
 
     // Create vertices 
     float theta, phi; // Angles for circles
@@ -1165,34 +1219,11 @@ void ResourceManager::CreateTorus(std::string object_name, float loop_radius, fl
             }
         }
     }
-
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
-
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
-
-    // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
 }
 
 
 
 void ResourceManager::CreateCube_noRoof(std::string object_name, float side_length) {
-	const int vertex_att = 11;
-	const int face_att = 3;
 
 	float half_length = side_length / 2;
 
@@ -1226,26 +1257,24 @@ void ResourceManager::CreateCube_noRoof(std::string object_name, float side_leng
 
 	};
 
-	GLuint vbo, ebo;
-	// Create OpenGL buffer for vertices
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 10 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	// Create OpenGL buffer for faces
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 8 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
-	AddResource(Mesh, object_name, vbo, ebo, 8 * face_att);
+	// Create resource
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 // Create the geometry for a Cylinder
 void ResourceManager::CreateCylinder(std::string object_name, float radius, float height) {
 
-	int num_loop_samples = 90;
-	int num_circle_samples = 30;
+	// Full detail first, then coarser levels for distant objects
+	for (int level = 0; level < NUM_LOD_LEVELS; level++) {
+		std::vector<GLfloat> vertex;
+		std::vector<GLuint> face;
+		BuildCylinder(radius, height, LodSamples(90, level, 2), LodSamples(30, level, 6), vertex, face);
+		AddLevel(object_name, level, vertex, face);
+	}
+}
+
+
+void ResourceManager::BuildCylinder(float radius, float height, int num_loop_samples, int num_circle_samples, std::vector<GLfloat> &vertex, std::vector<GLuint> &face) {
 
 	// Create a torus
 	// The torus is built from a large loop with small circles around the loop
@@ -1253,24 +1282,18 @@ void ResourceManager::CreateCylinder(std::string object_name, float radius, floa
 
 	// Number of vertices and faces to be created
 	const GLuint vertex_num = num_loop_samples * num_circle_samples;
-	const GLuint face_num = num_loop_samples * num_circle_samples * 2 + num_circle_samples * 2 - 4; //last num_circle_sample*2 is for top and bot face
+	// Two triangles per quad between consecutive circles, then a fan of
+	// num_circle_samples - 2 triangles closing each end
+	const GLuint side_num = (num_loop_samples - 1) * num_circle_samples * 2;
+	const GLuint face_num = side_num + (num_circle_samples - 2) * 2;
 
 	// Number of attributes for vertices and faces
 	const int vertex_att = 11;  // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
 	const int face_att = 3; // Vertex indices (3)
 
-	// Data buffers for the torus
-	GLfloat *vertex = NULL;
-	GLuint *face = NULL;
-
-	// Allocate memory for buffers
-	try {
-		vertex = new GLfloat[vertex_num * vertex_att];
-		face = new GLuint[face_num * face_att];
-	}
-	catch (std::exception &e) {
-		throw e;
-	}
+	// Data buffers
+	vertex.assign(vertex_num * vertex_att, 0.0f);
+	face.assign(face_num * face_att, 0);
 
 	// Create vertices 
 	float theta, phi; // Angles for circles
@@ -1326,41 +1349,21 @@ void ResourceManager::CreateCylinder(std::string object_name, float radius, floa
 		}
 	}
 
-	// Create triangles for top and bot
-	for (int i = 0; i < num_circle_samples - 2; i += 1) {
-		face[num_loop_samples*num_circle_samples * 2 * face_att + i * face_att] = 0;
-		face[num_loop_samples*num_circle_samples * 2 * face_att + i * face_att + 1] = i + 1;
-		face[num_loop_samples*num_circle_samples * 2 * face_att + i * face_att + 2] = i + 2;
-	}
-
-	for (int i = vertex_num - 1; i > vertex_num - 29; i -= 1) {
-		face[num_loop_samples*num_circle_samples * 2 * face_att + (num_circle_samples - 2)*face_att + (vertex_num - 1 - i) * face_att] = vertex_num - 1;
-		face[num_loop_samples*num_circle_samples * 2 * face_att + (num_circle_samples - 2)*face_att + (vertex_num - 1 - i) * face_att + 1] = i - 1;
-		face[num_loop_samples*num_circle_samples * 2 * face_att + (num_circle_samples - 2)*face_att + (vertex_num - 1 - i) * face_att + 2] = i - 2;
+	// Create triangles for top and bot, right after the sides
+	GLuint *cap = &face[side_num * face_att];
+	for (int i = 0; i < num_circle_samples - 2; i++) {
+		// Bottom circle: fan around its first vertex
+		cap[i * face_att] = 0;
+		cap[i * face_att + 1] = i + 1;
+		cap[i * face_att + 2] = i + 2;
+		// Top circle: fan around its last vertex, wound the other way
+		cap[(num_circle_samples - 2 + i) * face_att] = vertex_num - 1;
+		cap[(num_circle_samples - 2 + i) * face_att + 1] = vertex_num - 2 - i;
+		cap[(num_circle_samples - 2 + i) * face_att + 2] = vertex_num - 3 - i;
 	}
-
-	GLuint vbo, ebo;
-	// Create OpenGL buffer for vertices
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	// Create OpenGL buffer for faces
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
-	// Free data buffers
-	delete[] vertex;
-	delete[] face;
-
-	AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
 }
 
 void ResourceManager::CreateCube(std::string object_name, float side_length) {
-	const int vertex_att = 11;
-	const int face_att = 3;
 
 	float half_length = side_length / 2;
 
@@ -1418,19 +1421,8 @@ void ResourceManager::CreateCube(std::string object_name, float side_length) {
 		22,23,21,
 	};
 
-	GLuint vbo, ebo;
-	// Create OpenGL buffer for vertices
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 24 * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-	// Create OpenGL buffer for faces
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 24 * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-
-	AddResource(Mesh, object_name, vbo, ebo, 12 * face_att);
+	// Create resource
+	AddMesh(object_name, std::vector<GLfloat>(vertex, vertex + sizeof(vertex) / sizeof(GLfloat)), std::vector<GLuint>(face, face + sizeof(face) / sizeof(GLuint)));
 }
 
 
@@ -27,10 +27,23 @@ namespace game {
             // Add a resource that was already loaded and allocated to memory
             void AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
             void AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            // Add a mesh given in the interleaved layout (position, normal,
+            // color, uv); it is optimized and packed into a geometry arena
+            void AddMesh(const std::string name, std::vector<GLfloat> vertex, std::vector<GLuint> face);
             // Load a resource from a file, according to the specified type
             void LoadResource(ResourceType type, const std::string name, const char *filename);
             // Get the resource with the specified name
             Resource *GetResource(const std::string name) const;
+            // Free every resource and the geometry arenas the meshes live
+            // in; needs the context still current
+            void Clear(void);
+            // Create a vertex array object for geometry in the interleaved
+            // layout (position, normal, color, uv)
+            static GLuint CreateVertexArray(GLuint array_buffer, GLuint element_array_buffer);
+            // Object-space bounds of geometry in the interleaved layout
+            static Bounds ComputeBounds(const GLfloat *vertex, GLsizei vertex_count);
+            // Sample count of a procedural shape at a level of detail
+            static int LodSamples(int samples, int level, int min_samples);
 
 			void CreateTriangle(std::string object_name, float thick, float bot, float top, float height, bool tip);
 
@@ -38,6 +51,7 @@ namespace game {
 
 			// Methods to create specific resources
             // Create the geometry for a torus and add it to the list of resources
+            // Spheres, tori and cylinders come with NUM_LOD_LEVELS levels of detail
             void CreateTorus(std::string object_name, float loop_radius = 0.6, float circle_radius = 0.2, int num_loop_samples = 90, int num_circle_samples = 30);
             // Create the geometry for a sphere
 			void CreateSphere(std::string object_name, float radius_x, float radius_y, float radius_z, int num_samples_theta = 90, int num_samples_phi = 45);
@@ -65,12 +79,29 @@ namespace game {
             // Methods to load specific types of resources
             // Load shaders programs
             void LoadMaterial(const std::string name, const char *prefix);
+            // Link compiled shaders into a program and register it; 'gs' may be 0
+            static GLuint LinkProgram(GLuint vs, GLuint fs, GLuint gs);
 
             // Load a text file into memory (could be source code)
             std::string LoadTextFile(const char *filename);
 
 			void LoadTexture(const std::string name, const char * filename);
 
+			// Add one level of detail of a procedural mesh: level 0 creates the
+			// resource, the others are attached to it
+			void AddLevel(const std::string name, int level, std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+
+			// Move a mesh in the interleaved layout into the geometry arena
+			// of its packed layout; the mesh is optimized on the way, and
+			// 'name' labels its report
+			static GeometryRange PackMesh(const std::string &name, std::vector<GLfloat> &vertex, std::vector<GLuint> &face, Bounds &bounds);
+
+			// Generate the vertices and triangles of procedural shapes at a
+			// given sampling
+			static void BuildSphere(float radius_x, float radius_y, float radius_z, int num_samples_theta, int num_samples_phi, std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+			static void BuildTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples, std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+			static void BuildCylinder(float radius, float height, int num_loop_samples, int num_circle_samples, std::vector<GLfloat> &vertex, std::vector<GLuint> &face);
+
 
 
 
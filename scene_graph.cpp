@@ -1,12 +1,17 @@
 #include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <tuple>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include "scene_graph.h"
+#include "shader_program.h"
+#include "gl_state.h"
 
 namespace game {
 
@@ -17,6 +22,10 @@ SceneGraph::SceneGraph(void){
 
 
 SceneGraph::~SceneGraph(){
+
+	// The graph owns its nodes and batches
+	ClearNodes();
+	ClearStatic();
 }
 
 
@@ -44,27 +53,360 @@ SceneNode *SceneGraph::CreateNode(std::string node_name, Resource *geometry, Res
 }
 
 void SceneGraph::AddNode(SceneNode *node) {
-	hieNodeList.push_back(node);
+	if (node->graph_ != this || node->rootSlot_ < 0) {
+		node->rootSlot_ = (int)hieNodeList.size();
+		hieNodeList.push_back(node);
+	}
+	RegisterNode(node);
 	return;
 }
 
 
-SceneNode* SceneGraph::GetNode(std::string node_name){
+SceneNode* SceneGraph::GetNode(const std::string &node_name) const {
+
+	// Find node with the specified name
+	std::unordered_map<std::string, std::vector<SceneNode*> >::const_iterator it = nameIndex.find(node_name);
+	if (it != nameIndex.end() && !it->second.empty()) {
+		return it->second.front();
+	}
+	std::cout << node_name << " not found" << std::endl;
+	return NULL;
+}
+
+
+SceneNode* SceneGraph::GetNodeByHandle(NodeHandle handle) const {
+
+	if (handle < 0 || handle >= (NodeHandle)handleTable.size()) {
+		return NULL;
+	}
+	return handleTable[handle];
+}
+
+
+NodeRef SceneGraph::GetRef(SceneNode *node) const {
+
+	NodeRef ref;
+	if (node && node->graph_ == this) {
+		ref.handle = node->handle_;
+		ref.generation = handleGenerations[node->handle_];
+	}
+	return ref;
+}
+
+
+SceneNode* SceneGraph::Resolve(const NodeRef &ref) const {
+
+	if (ref.handle < 0 || ref.handle >= (NodeHandle)handleTable.size() || handleGenerations[ref.handle] != ref.generation) {
+		return NULL;
+	}
+	return handleTable[ref.handle];
+}
+
+
+void SceneGraph::ReserveNodes(int count, int roots) {
+
+	// Released handles are reused first; only the rest extend the tables
+	int grow = count - (int)freeHandles.size();
+	if (grow > 0) {
+		handleTable.reserve(handleTable.size() + grow);
+		handleGenerations.reserve(handleTable.size() + grow);
+	}
+	transforms_.Reserve(count, (int)handleTable.size() + (grow > 0 ? grow : 0) - 1);
+	hieNodeList.reserve(hieNodeList.size() + roots);
+}
+
+
+void SceneGraph::RegisterNode(SceneNode *node) {
 
-    // Find node with the specified name
-    for (int i = 0; i < hieNodeList.size(); i++){
-		if (hieNodeList[i]->GetName() == node_name) {
-				return hieNodeList[i];
+	// Nodes reachable through several paths are only registered once, but
+	// their transform follows the latest parent
+	if (node->graph_ == this) {
+		if (node->parent && node->parent->graph_ == this) {
+			transforms_.SetParent(node->handle_, node->parent->handle_);
 		}
-		else if(hieNodeList[i]->GetChildren()->size()>0){
-			SceneNode* r = hieNodeList[i]->FindIt(node_name);
-			if (r != NULL) {
-				return r;
-			}
+		return;
+	}
+
+	// Reuse a released handle if there is one
+	NodeHandle handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		handleTable[handle] = node;
+	}
+	else {
+		handle = (NodeHandle)handleTable.size();
+		handleTable.push_back(node);
+		if (handle >= (NodeHandle)handleGenerations.size()) {
+			handleGenerations.push_back(0);
 		}
-    }
-	std::cout << node_name << " not found" << std::endl;
-    return NULL;
+	}
+	node->graph_ = this;
+	node->handle_ = handle;
+
+	NodeHandle parent_handle = INVALID_NODE_HANDLE;
+	if (node->parent && node->parent->graph_ == this) {
+		parent_handle = node->parent->handle_;
+	}
+	transforms_.Insert(handle, parent_handle);
+	transforms_.SetBounds(handle, node->bounds_);
+	node->localDirty_ = true;
+	dirtyTransforms.push_back(handle);
+
+	std::vector<SceneNode*> &bucket = nameIndex[node->name_];
+	node->nameSlot_ = (int)bucket.size();
+	bucket.push_back(node);
+
+	entities_.Add(node);
+
+	// Children attached before the node was added come along with it
+	for (SceneNode *child = node->firstChild; child; child = child->nextSibling) {
+		RegisterNode(child);
+	}
+}
+
+
+void SceneGraph::UnregisterNode(SceneNode *node) {
+
+	if (node->graph_ != this) {
+		return;
+	}
+
+	RemoveFromBucket(node);
+
+	entities_.Remove(node);
+	transforms_.Remove(node->handle_);
+	handleTable[node->handle_] = NULL;
+	handleGenerations[node->handle_]++;
+	freeHandles.push_back(node->handle_);
+	node->graph_ = NULL;
+	node->handle_ = INVALID_NODE_HANDLE;
+	node->nameSlot_ = -1;
+
+	for (SceneNode *child = node->firstChild; child; child = child->nextSibling) {
+		UnregisterNode(child);
+	}
+}
+
+
+void SceneGraph::RemoveFromBucket(SceneNode *node) {
+
+	// Shift the later nodes down instead of swapping the last one in, so
+	// the bucket stays in registration order
+	std::vector<SceneNode*> &bucket = nameIndex[node->name_];
+	bucket.erase(bucket.begin() + node->nameSlot_);
+	for (size_t i = node->nameSlot_; i < bucket.size(); i++) {
+		bucket[i]->nameSlot_ = (int)i;
+	}
+	if (bucket.empty()) {
+		nameIndex.erase(node->name_);
+	}
+}
+
+
+void SceneGraph::RenameNode(SceneNode *node, const std::string &new_name) {
+
+	if (node->graph_ != this) {
+		return;
+	}
+
+	RemoveFromBucket(node);
+
+	std::vector<SceneNode*> &new_bucket = nameIndex[new_name];
+	node->nameSlot_ = (int)new_bucket.size();
+	new_bucket.push_back(node);
+}
+
+
+void SceneGraph::ClearNodes(void) {
+
+	// Roots owned by a parent in the graph are freed along with that parent
+	std::vector<SceneNode*> owned_roots;
+	for (size_t i = 0; i < hieNodeList.size(); i++) {
+		SceneNode *root = hieNodeList[i];
+		if (!root->parent || root->parent->graph_ != this) {
+			owned_roots.push_back(root);
+		}
+	}
+
+	for (size_t i = 0; i < handleTable.size(); i++) {
+		// Generations outlive the table so that references to the cleared
+		// nodes stay stale when the handles are given out again
+		handleGenerations[i]++;
+		if (handleTable[i]) {
+			handleTable[i]->graph_ = NULL;
+			handleTable[i]->handle_ = INVALID_NODE_HANDLE;
+			handleTable[i]->nameSlot_ = -1;
+		}
+	}
+	for (size_t i = 0; i < hieNodeList.size(); i++) {
+		hieNodeList[i]->rootSlot_ = -1;
+	}
+	hieNodeList.clear();
+	entities_.Clear();
+	nameIndex.clear();
+	handleTable.clear();
+	freeHandles.clear();
+	transforms_.Clear();
+	dirtyTransforms.clear();
+	destroyQueue.clear();
+
+	for (size_t i = 0; i < owned_roots.size(); i++) {
+		DeleteSubtree(owned_roots[i]);
+	}
+}
+
+
+bool SceneGraph::IsStaticTree(SceneNode *node) {
+
+	if (!node->static_) {
+		return false;
+	}
+	for (SceneNode *child = node->firstChild; child; child = child->nextSibling) {
+		if (!IsStaticTree(child)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void SceneGraph::ClearStatic(void) {
+
+	for (size_t i = 0; i < staticBatches.size(); i++) {
+		delete staticBatches[i];
+	}
+	staticBatches.clear();
+}
+
+
+void SceneGraph::BakeStatic(void) {
+
+	// World matrices of the static nodes must be up to date
+	UpdateTransforms();
+
+	// Only whole subtrees hanging from a parentless root can be baked
+	std::vector<SceneNode*> baked;
+	for (size_t i = 0; i < hieNodeList.size(); i++) {
+		SceneNode *root = hieNodeList[i];
+		if (!root->parent && IsStaticTree(root)) {
+			baked.push_back(root);
+		}
+	}
+	if (baked.empty()) {
+		return;
+	}
+
+	// Group the triangles of the baked nodes by material, texture and environment map
+	typedef std::tuple<GLuint, GLuint, GLuint> BatchKey;
+	std::map<BatchKey, StaticBatch*> batches;
+	std::vector<SceneNode*> stack(baked.begin(), baked.end());
+	while (!stack.empty()) {
+		SceneNode *node = stack.back();
+		stack.pop_back();
+		for (SceneNode *child = node->firstChild; child; child = child->nextSibling) {
+			stack.push_back(child);
+		}
+		if (node->mode_ != GL_TRIANGLES || node->size_ <= 0) {
+			continue;
+		}
+
+		BatchKey key(node->material_, node->texture_, node->envmap_);
+		StaticBatch *&batch = batches[key];
+		if (!batch) {
+			batch = new StaticBatch(node->material_, node->depth_material_, node->texture_, node->envmap_);
+		}
+		batch->AddGeometry(node, GetWorldMatrix(node->handle_));
+	}
+
+	for (std::map<BatchKey, StaticBatch*>::iterator it = batches.begin(); it != batches.end(); it++) {
+		it->second->Finish();
+		staticBatches.push_back(it->second);
+	}
+
+	// The batches replace the baked nodes
+	for (size_t i = 0; i < baked.size(); i++) {
+		RemoveRoot(baked[i]);
+		UnregisterNode(baked[i]);
+		DeleteSubtree(baked[i]);
+	}
+}
+
+
+void SceneGraph::RemoveRoot(SceneNode *node) {
+
+	SceneNode *last = hieNodeList.back();
+	hieNodeList[node->rootSlot_] = last;
+	last->rootSlot_ = node->rootSlot_;
+	hieNodeList.pop_back();
+	node->rootSlot_ = -1;
+}
+
+
+void SceneGraph::DeleteSubtree(SceneNode *node) {
+
+	SceneNode *child = node->firstChild;
+	while (child) {
+		SceneNode *next = child->nextSibling;
+		// Some parts are also listed as roots and must leave the root list
+		if (child->rootSlot_ >= 0) {
+			RemoveRoot(child);
+		}
+		DeleteSubtree(child);
+		child = next;
+	}
+	delete node;
+}
+
+
+void SceneGraph::FlushDestroyed(void) {
+
+	if (destroyQueue.empty()) {
+		return;
+	}
+
+	// Detach every queued node first, so that a node queued together with
+	// one of its ancestors is not freed twice
+	std::vector<SceneNode*> detached;
+	for (size_t i = 0; i < destroyQueue.size(); i++) {
+		SceneNode *node = destroyQueue[i];
+		if (node->graph_ != this) {
+			continue;
+		}
+		if (node->rootSlot_ >= 0) {
+			RemoveRoot(node);
+		}
+		if (node->parent) {
+			node->parent->RemoveChild(node);
+		}
+		UnregisterNode(node);
+		detached.push_back(node);
+	}
+	destroyQueue.clear();
+
+	for (size_t i = 0; i < detached.size(); i++) {
+		DeleteSubtree(detached[i]);
+	}
+}
+
+
+void SceneGraph::UpdateTransforms(void) {
+
+	CopyLocalTransforms();
+	transforms_.Update(&workers_);
+}
+
+
+void SceneGraph::CopyLocalTransforms(void) {
+
+	for (size_t i = 0; i < dirtyTransforms.size(); i++) {
+		SceneNode *node = GetNodeByHandle(dirtyTransforms[i]);
+		if (node && node->localDirty_) {
+			transforms_.SetLocal(node->handle_, node->position_, node->orientation_, node->scale_, node->rotOrigin);
+			node->localDirty_ = false;
+		}
+	}
+	dirtyTransforms.clear();
 }
 
 
@@ -83,16 +425,37 @@ std::vector<SceneNode *>::const_iterator SceneGraph::end() const {
 
 void SceneGraph::Draw(Camera *camera){
 
+	// Count the state calls of this frame apart from the last one
+	GLState::BeginFrame();
+
     // Clear background
     glClearColor(background_color_[0], 
                  background_color_[1],
                  background_color_[2], 0.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	
-	for (int i = 0; i < hieNodeList.size(); i++) {
-		hieNodeList[i]->Draw(camera);
-	}
 
+	DrawScene(camera);
+}
+
+
+void SceneGraph::DrawScene(Camera *camera) {
+
+	// Camera and timer are shared by every draw of the frame
+	camera->SetupFrame();
+
+	renderQueue_.Begin(camera);
+	for (size_t i = 0; i < staticBatches.size(); i++) {
+		staticBatches[i]->Submit(&renderQueue_, camera);
+	}
+	for (size_t i = 0; i < hieNodeList.size(); i++) {
+		// Roots that also hang from a node of the graph are drawn with their parent
+		SceneNode *root = hieNodeList[i];
+		if (root->parent && root->parent->graph_ == this) {
+			continue;
+		}
+		root->Submit(&renderQueue_, camera);
+	}
+	renderQueue_.Draw();
 }
 
 void SceneGraph::SaveTexture(char *filename) {
@@ -142,7 +505,7 @@ void SceneGraph::SetupDrawToTexture(void) {
 
 	// Set up target texture for rendering
 	glGenTextures(1, &texture_);
-	glBindTexture(GL_TEXTURE_2D, texture_);
+	GLState::BindTexture(0, GL_TEXTURE_2D, texture_);
 
 	// Set up an image for the texture
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
@@ -182,19 +545,31 @@ void SceneGraph::SetupDrawToTexture(void) {
 	glGenBuffers(1, &quad_array_buffer_);
 	glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertex_data), quad_vertex_data, GL_STATIC_DRAW);
+
+	// Vertex layout of the quad: position and uv
+	glGenVertexArrays(1, &quad_vertex_array_);
+	glBindVertexArray(quad_vertex_array_);
+	glVertexAttribPointer(VERTEX_ATTRIB, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
+	glEnableVertexAttribArray(VERTEX_ATTRIB);
+	glVertexAttribPointer(UV_ATTRIB, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(UV_ATTRIB);
+	glBindVertexArray(0);
 }
 
 
 
 void SceneGraph::DrawToTexture(Camera *camera) {
 
+	// Count the state calls of this frame apart from the last one
+	GLState::BeginFrame();
+
 	// Save current viewport
 	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLState::GetViewport(viewport);
 
 	// Enable frame buffer
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_);
-	glViewport(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
+	GLState::Viewport(0, 0, FRAME_BUFFER_WIDTH, FRAME_BUFFER_HEIGHT);
 
 	// Clear background
 	glClearColor(background_color_[0],
@@ -203,15 +578,13 @@ void SceneGraph::DrawToTexture(Camera *camera) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// Draw all scene nodes
-	for (int i = 0; i < hieNodeList.size(); i++) {
-		hieNodeList[i]->Draw(camera);
-	}
+	DrawScene(camera);
 
 	// Reset frame buffer
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// Restore viewport
-	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	GLState::Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
 
 
@@ -219,41 +592,31 @@ void SceneGraph::DisplayTexture(GLuint program, int type) {
 
 	// Configure output to the screen
 	//glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glDisable(GL_DEPTH_TEST);
+	GLState::Disable(GL_DEPTH_TEST);
 
 	// Set up quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, quad_array_buffer_);
+	GLState::BindVertexArray(quad_vertex_array_);
 
 	// Select proper material (shader program)
-	glUseProgram(program);
+	GLState::UseProgram(program);
+	const ShaderLocations &loc = ShaderProgram::GetLocations(program);
 
-	// Setup attributes of screen-space shader
-	GLint pos_att = glGetAttribLocation(program, "position");
-	glEnableVertexAttribArray(pos_att);
-	glVertexAttribPointer(pos_att, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
-
-	GLint tex_att = glGetAttribLocation(program, "uv");
-	glEnableVertexAttribArray(tex_att);
-	glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
-
-	// Timer
-	GLint timer_var = glGetUniformLocation(program, "timer");
-	float current_time = glfwGetTime();
-	glUniform1f(timer_var, current_time);
+	// The timer comes from the frame block
 
 	// Effect type
-	GLint type_var = glGetUniformLocation(program, "type");
+	GLint type_var = loc.type;
 	glUniform1i(type_var, type);
 
-	// Bind texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture_);
+	// Bind texture; the render target has no mipmaps and keeps its own filtering
+	GLState::BindSampler(0, 0);
+	GLState::BindTexture(0, GL_TEXTURE_2D, texture_);
 
 	// Draw geometry
 	glDrawArrays(GL_TRIANGLES, 0, 6); // Quad: 6 coordinates
+	GLState::BindVertexArray(0);
 
 	// Reset current geometry
-	glEnable(GL_DEPTH_TEST);
+	GLState::Enable(GL_DEPTH_TEST);
 }
 
 // handle melee, catch chicken
@@ -262,13 +625,14 @@ int SceneGraph::delicious(glm::vec3 pos) {
 	std::vector<SceneNode*> BeenEat;
 	for (int i = 0; i < hieNodeList.size(); i++) {
 		SceneNode* curr = hieNodeList[i];
-		if (curr->GetName() == "Hen_Body" || curr->GetName() == "CK_Body") {
+		NodeKind kind = curr->GetKind();
+		if (kind == HenKind || kind == ChickenKind) {
 			float distance = glm::length(curr->GetPosition() - pos);
 			// Hen successfully protect chicken
-			if (curr->GetName() == "Hen_Body" && distance <= 10 && curr->getStun()<=0) {
+			if (kind == HenKind && distance <= 10 && curr->getStun()<=0) {
 				return -1;
 			}
-			if (curr->GetName() == "CK_Body" && distance <= 10) {
+			if (kind == ChickenKind && distance <= 10) {
 				Eat += 1;
 				BeenEat.push_back(curr);
 				
@@ -294,205 +658,282 @@ glm::vec3 SceneGraph::getRandomPos(float radius, glm::vec3 pos, float footvalue)
 	return POS;
 }
 
-void SceneGraph::Update(void) {
-	// temp position, shared from hen to chicken, the 'escape' range
-	glm::vec3 escape;
-	SceneNode* Bird = this->GetNode("Camera");
-	SceneNode* act_bird = this->GetNode("Body");
+// Turn a node around the vertical axis so that it faces a target
+static void FaceTarget(SceneNode *curr, const glm::vec3 &target) {
 
-	for (int i = 0; i < hieNodeList.size(); i++) {
-		SceneNode* curr = hieNodeList[i];
-		// calculate distance to target
-		glm::vec3 targer_pos = curr->getTarget();
-		glm::vec3 poss = curr->GetPosition();
-		float dis_target = sqrt((targer_pos.x - poss.x)*(targer_pos.x - poss.x) + (targer_pos.y - poss.y)*(targer_pos.y - poss.y) + (targer_pos.z - poss.z)*(targer_pos.z - poss.z));
-		// calculate distance to bird
-
-		glm::vec3 poss_bird = Bird->GetPosition();
-		float dis_bird = sqrt((poss.x - poss_bird.x)*(poss.x - poss_bird.x) + (poss.y - poss_bird.y)*(poss.y - poss_bird.y) + (poss.z - poss_bird.z)*(poss.z - poss_bird.z));
-
-		// AI logic for drone**************************************************************************************************************
-		// *********************************************************************************************************************************
-		if (curr->GetName() == "Drone_Body") {
-			
-			if (dis_target < 2) {
-				// factor: how far infront of bird the drone will chase
-				float LastR = curr->getRest();
-				curr->setRest(LastR - 1);
-				curr->SetSpeed(0.00);
-				if (curr->getRest() <= 0) {
-					float factor = 5.0;
-					glm::vec3 target = Bird->GetPosition() + Bird->GetForward()*Bird->GetSpeed();
-					curr->setTarget(target);
-					//reset rest
-					float restt = rand() % 300 + 1;
-					curr->setRest(restt);
+	glm::vec3 a = curr->GetForward();
+	glm::vec3 b = target - curr->GetPosition();
+	float angle = acos(glm::dot(a, b) / (glm::length(a)*glm::length(b)));
+	float dir = a.x*b.z - a.z*b.x > 0 ? -1.0f : 1.0f;
+	angle = angle * 180 / glm::pi<float>();
+	glm::quat rotation = glm::angleAxis(dir*angle * glm::pi<float>() / 180.0f, glm::vec3(0, 1, 0));
+	curr->Rotate(rotation);
+}
 
-				}
-			}
 
-			else {
-				// set direction
-				curr->SetSpeed(0.03);
-				curr->SetForward(curr->getTarget() - curr->GetPosition());
-			}
+void SceneGraph::ParallelFor(int count, const std::function<void(int, int)> &range) {
 
-			// collision between drone and bird
-			if (dis_bird < 3){
-				Bird->setStun(90);
-				curr->SetShouldBeDestoried(true);
-			}
-		}
+	// One job per thread, but no job smaller than min_chunk entities so
+	// that the scheduling does not cost more than the work; archetypes of
+	// up to min_chunk entities run on the calling thread
+	const int min_chunk = 16;
+	int concurrency = workers_.GetConcurrency();
+	int chunk = std::max(min_chunk, (count + concurrency - 1) / concurrency);
+	int num_jobs = (count + chunk - 1) / chunk;
+	workers_.Run(num_jobs, [count, chunk, &range](int job) {
+		int begin = job * chunk;
+		range(begin, std::min(begin + chunk, count));
+	});
+}
 
-		// AI logic for Hen**************************************************************************************************************
-		// *********************************************************************************************************************************
-		if (curr->GetName() == "Hen_Body") {
-			// If Bird is far from hen, hen will move to random place
-			// Else hen move to a point that bird might come
-			glm::vec3 a = Bird->GetPosition();
-			glm::vec3 b = curr->GetPosition();
-			float distance_from_bird = sqrt((a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y) + (a.z - b.z)*(a.z - b.z));
-			// normal
-			if (distance_from_bird >= 40) {
-				curr->setMoving_Center(glm::vec3(0.0, -23.7, 0.0));
-				curr->setMoving_Range_radius(150);
-			}
-			// warning
-			else {
-				glm::vec3 POS = glm::vec3(Bird->GetPosition().x, -23.7, Bird->GetPosition().z) + glm::vec3(Bird->GetForward().x * (Bird->GetPosition().y + 23.7), 0, Bird->GetForward().z * (Bird->GetPosition().y + 23.7));
-				if (POS.x >= 130) { POS = glm::vec3(130, POS.y, POS.z); }
-				if (POS.x <= -130) { POS = glm::vec3(-130, POS.y, POS.z); }
-				if (POS.z >= 130) { POS = glm::vec3(POS.x, POS.y, 130); }
-				if (POS.z <= -130) { POS = glm::vec3(POS.x, POS.y, -130); }
-				escape = POS;
-				curr->setMoving_Center(POS);
-				curr->setMoving_Range_radius(20);
-			}
-			if (dis_target < 2) {
-				float LastR = curr->getRest();
-				curr->setRest(LastR - 1);
-				curr->SetSpeed(0);
-				if (curr->getRest() <= 0) {
-					glm::vec3 target = getRandomPos(curr->getMoving_Range_radius(), curr->getMoving_Center(), -23.7);
-					curr->setTarget(target);
-					//reset rest
-					float restt = rand() % 200 + 100;
-					curr->setRest(restt);
-
-					//get correct oriantation
-					glm::vec3 a = curr->GetForward();
-					glm::vec3 b = curr->getTarget() - curr->GetPosition();
-					float angle = acos(glm::dot(a, b) / (glm::length(a)*glm::length(b)));
-					float dir = a.x*b.z - a.z*b.x > 0 ? -1.0f : 1.0f;
-					angle = angle * 180 / glm::pi<float>();
-					glm::quat rotation = glm::angleAxis(dir*angle * glm::pi<float>() / 180.0f, glm::vec3(0, 1, 0));
-					curr->Rotate(rotation);
 
+void SceneGraph::ReadAI(void) {
+
+	// Only contiguous components are read here: positions come from the
+	// transform store through the slots kept in the archetypes, and the
+	// nodes themselves are left to WriteAI
+	const AITickState &tick = aiTick;
+
+	// drone: reached target, hit the bird
+	Archetype &drones = entities_.GetDrones();
+	droneDecisions.resize(drones.Size());
+	ParallelFor(drones.Size(), [this, &drones, &tick](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			glm::vec3 pos = transforms_.GetPosition(drones.GetTransform(i));
+			AIDecision &d = droneDecisions[i];
+			d.arrived = glm::length(drones.GetAI(i).target - pos) < 2;
+			d.hit_bird = glm::length(pos - tick.bird_position) < 3;
+		}
+	});
+
+	// hen: reached target, bird close by, caught by the tornado
+	Archetype &hens = entities_.GetHens();
+	henDecisions.resize(hens.Size());
+	ParallelFor(hens.Size(), [this, &hens, &tick](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			glm::vec3 pos = transforms_.GetPosition(hens.GetTransform(i));
+			AIDecision &d = henDecisions[i];
+			d.arrived = glm::length(hens.GetAI(i).target - pos) < 2;
+			d.warned = glm::length(tick.bird_position - pos) < 40;
+			d.in_suck = glm::length(tick.suck - pos) <= 10;
+		}
+	});
+
+	// chicken: reached target, close to the escape point, caught by the tornado
+	Archetype &chickens = entities_.GetChickens();
+	chickenDecisions.resize(chickens.Size());
+	ParallelFor(chickens.Size(), [this, &chickens, &tick](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			glm::vec3 pos = transforms_.GetPosition(chickens.GetTransform(i));
+			AIDecision &d = chickenDecisions[i];
+			d.arrived = glm::length(chickens.GetAI(i).target - pos) < 2;
+			d.warned = tick.escape_valid && glm::length(pos - tick.escape) < 7;
+			d.in_suck = glm::length(tick.suck - pos) <= 10;
+		}
+	});
+
+	// missile: drones and hens it collides with
+	Archetype &missiles = entities_.GetMissiles();
+	missileDroneHits.resize(missiles.Size());
+	missileHenHits.resize(missiles.Size());
+	ParallelFor(missiles.Size(), [this, &missiles, &drones, &hens](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			glm::vec3 missile_pos = transforms_.GetPosition(missiles.GetTransform(i));
+			missileDroneHits[i].clear();
+			missileHenHits[i].clear();
+			for (int j = 0; j < drones.Size(); j++) {
+				if (glm::length(transforms_.GetPosition(drones.GetTransform(j)) - missile_pos) <= 1.2) {
+					missileDroneHits[i].push_back(j);
 				}
 			}
-
-			else {
-				// set direction
-				curr->SetSpeed(0.04);
-				
+			for (int j = 0; j < hens.Size(); j++) {
+				if (glm::length(transforms_.GetPosition(hens.GetTransform(j)) - missile_pos) <= 2.1) {
+					missileHenHits[i].push_back(j);
+				}
 			}
+		}
+	});
+}
 
-			float diss_suck = glm::length(suck - b);
-			if (diss_suck <= 10) {
-				curr->setStun(50);
-			}
 
+void SceneGraph::WriteAI(SceneNode *Bird) {
+
+	const AITickState &tick = aiTick;
 
-			// handle stun
-			if (curr->getStun() >= 0) {
-				curr->SetSpeed(0.0);
+	// AI logic for drone**************************************************************************************************************
+	// *********************************************************************************************************************************
+	Archetype &drones = entities_.GetDrones();
+	for (int i = 0; i < drones.Size(); i++) {
+		SceneNode* curr = drones.GetNode(i);
+		AIState &ai = drones.GetAI(i);
+		const AIDecision &d = droneDecisions[i];
+
+		if (d.arrived) {
+			ai.rest -= 1;
+			curr->SetSpeed(0.00);
+			if (ai.rest <= 0) {
+				// chase the point the bird is flying to
+				ai.target = tick.bird_position + tick.bird_forward*tick.bird_speed;
+				//reset rest
+				ai.rest = rand() % 300 + 1;
 			}
 		}
 
-		// AI logic for chicken**************************************************************************************************************
-		// *********************************************************************************************************************************
-		if (curr->GetName() == "CK_Body") {
-			glm::vec3 a = curr->GetPosition();
-			float distance_from_escape = sqrt((a.x - escape.x)*(a.x - escape.x) + (a.y - escape.y)*(a.y - escape.y) + (a.z - escape.z)*(a.z - escape.z));
-			// warned
-			if (distance_from_escape < 7) {
-				float factor = 20;
-				glm::vec3 targe = curr->GetPosition() + (curr->GetPosition() - escape) * factor;
-				curr->setTarget(targe);
+		else {
+			// set direction
+			curr->SetSpeed(0.03);
+			curr->SetForward(ai.target - curr->GetPosition());
+		}
+
+		// collision between drone and bird
+		if (d.hit_bird){
+			Bird->setStun(90);
+			curr->SetShouldBeDestoried(true);
+		}
+	}
+
+	// AI logic for Hen**************************************************************************************************************
+	// *********************************************************************************************************************************
+	Archetype &hens = entities_.GetHens();
+	for (int i = 0; i < hens.Size(); i++) {
+		SceneNode* curr = hens.GetNode(i);
+		AIState &ai = hens.GetAI(i);
+		const AIDecision &d = henDecisions[i];
+
+		// If Bird is far from hen, hen will move to random place
+		// Else hen move to the point that bird might come
+		if (!d.warned) {
+			ai.moving_center = glm::vec3(0.0, -23.7, 0.0);
+			ai.moving_radius = 150;
+		}
+		else {
+			ai.moving_center = tick.escape;
+			ai.moving_radius = 20;
+		}
+		if (d.arrived) {
+			ai.rest -= 1;
+			curr->SetSpeed(0);
+			if (ai.rest <= 0) {
+				ai.target = getRandomPos(ai.moving_radius, ai.moving_center, -23.7);
+				//reset rest
+				ai.rest = rand() % 200 + 100;
 				//get correct oriantation
-				glm::vec3 a = curr->GetForward();
-				glm::vec3 b = curr->getTarget() - curr->GetPosition();
-				float angle = acos(glm::dot(a, b) / (glm::length(a)*glm::length(b)));
-				float dir = a.x*b.z - a.z*b.x > 0 ? -1.0f : 1.0f;
-				angle = angle * 180 / glm::pi<float>();
-				glm::quat rotation = glm::angleAxis(dir*angle * glm::pi<float>() / 180.0f, glm::vec3(0, 1, 0));
-				curr->Rotate(rotation);
-			}
-			// normal
-			if (dis_target < 2) {
-				float LastR = curr->getRest();
-				curr->setRest(LastR - 1);
-				curr->SetSpeed(0);
-				if (curr->getRest() <= 0) {
-					glm::vec3 target = getRandomPos(150, glm::vec3(0.0, -24.3, 0.0), -24.3);
-					curr->setTarget(target);
-					//reset rest
-					float restt = rand() % 300 + 400;
-					curr->setRest(restt);
-
-					//get correct oriantation
-					glm::vec3 a = curr->GetForward();
-					glm::vec3 b = curr->getTarget() - curr->GetPosition();
-					float angle = acos(glm::dot(a, b) / (glm::length(a)*glm::length(b)));
-					float dir = a.x*b.z - a.z*b.x > 0 ? -1.0f : 1.0f;
-					angle = angle * 180 / glm::pi<float>();
-					glm::quat rotation = glm::angleAxis(dir*angle * glm::pi<float>() / 180.0f, glm::vec3(0, 1, 0));
-					curr->Rotate(rotation);
-				}
-			}
-			else {
-				// set direction
-				curr->SetSpeed(0.024);
+				FaceTarget(curr, ai.target);
 			}
+		}
 
-			// tonado suck
-			float diss_suck = glm::length(suck - a);
-			if (diss_suck <= 10) {
-				curr->SetPosition(suck);
-			}
+		else {
+			// set direction
+			curr->SetSpeed(0.04);
+		}
 
+		if (d.in_suck) {
+			curr->setStun(50);
 		}
 
-		// collision logic for missile ************************************************************************************
-		// *********************************************************************************************************************************
-		if (curr->GetName() == "Missile") {
-			for (int j = 0; j < hieNodeList.size(); j++) {
-				SceneNode* current = hieNodeList[j];
-				float distance = glm::length(current->GetPosition() - curr->GetPosition());
-				// collision between missile and drone
-				if (current->GetName() == "Drone_Body") {
-					if (distance <= 1.2) {
-						current->SetShouldBeDestoried(true);
-						curr->SetShouldBeDestoried(true);
-					}
-				}
-				// collision between missile and hen
-				if (current->GetName() == "Hen_Body") {
-					if (distance <= 2.1) {
-						current->setStun(50);
-						curr->SetShouldBeDestoried(true);
-					}
-				}
+		// handle stun
+		if (curr->getStun() >= 0) {
+			curr->SetSpeed(0.0);
+		}
+	}
+
+	// AI logic for chicken**************************************************************************************************************
+	// *********************************************************************************************************************************
+	Archetype &chickens = entities_.GetChickens();
+	for (int i = 0; i < chickens.Size(); i++) {
+		SceneNode* curr = chickens.GetNode(i);
+		AIState &ai = chickens.GetAI(i);
+		const AIDecision &d = chickenDecisions[i];
+
+		// warned
+		if (d.warned) {
+			float factor = 20;
+			ai.target = curr->GetPosition() + (curr->GetPosition() - tick.escape) * factor;
+			//get correct oriantation
+			FaceTarget(curr, ai.target);
+		}
+		// normal
+		if (d.arrived) {
+			ai.rest -= 1;
+			curr->SetSpeed(0);
+			if (ai.rest <= 0) {
+				ai.target = getRandomPos(150, glm::vec3(0.0, -24.3, 0.0), -24.3);
+				//reset rest
+				ai.rest = rand() % 300 + 400;
+				//get correct oriantation
+				FaceTarget(curr, ai.target);
 			}
 		}
+		else {
+			// set direction
+			curr->SetSpeed(0.024);
+		}
 
-		if (curr->GetName() == "Skybox") {
-			curr->SetPosition(Bird->GetPosition());
+		// tonado suck
+		if (d.in_suck) {
+			curr->SetPosition(tick.suck);
 		}
+	}
 
-		// update position and rotation
+	// collision logic for missile ************************************************************************************
+	// *********************************************************************************************************************************
+	Archetype &missiles = entities_.GetMissiles();
+	for (int i = 0; i < missiles.Size(); i++) {
+		SceneNode* curr = missiles.GetNode(i);
+		for (size_t j = 0; j < missileDroneHits[i].size(); j++) {
+			drones.GetNode(missileDroneHits[i][j])->SetShouldBeDestoried(true);
+			curr->SetShouldBeDestoried(true);
+		}
+		for (size_t j = 0; j < missileHenHits[i].size(); j++) {
+			hens.GetNode(missileHenHits[i][j])->setStun(50);
+			curr->SetShouldBeDestoried(true);
+		}
+	}
+}
+
+
+void SceneGraph::Update(void) {
+	SceneNode* Bird = this->GetNode("Camera");
+
+	// The AI reads positions from the transform store; nodes spawned or
+	// moved since the last update are copied in first
+	CopyLocalTransforms();
+
+	// State every AI decision of the tick is made from
+	aiTick.bird_position = Bird->GetPosition();
+	aiTick.bird_forward = Bird->GetForward();
+	aiTick.bird_speed = Bird->GetSpeed();
+	aiTick.suck = suck;
+
+	// The point the hens run to when the bird comes close, which is also
+	// the point the chickens flee from
+	glm::vec3 POS = glm::vec3(aiTick.bird_position.x, -23.7, aiTick.bird_position.z) + glm::vec3(aiTick.bird_forward.x * (aiTick.bird_position.y + 23.7), 0, aiTick.bird_forward.z * (aiTick.bird_position.y + 23.7));
+	POS.x = glm::clamp(POS.x, -130.0f, 130.0f);
+	POS.z = glm::clamp(POS.z, -130.0f, 130.0f);
+	aiTick.escape = POS;
+	aiTick.escape_valid = false;
+	Archetype &hens = entities_.GetHens();
+	for (int i = 0; i < hens.Size() && !aiTick.escape_valid; i++) {
+		aiTick.escape_valid = glm::length(aiTick.bird_position - transforms_.GetPosition(hens.GetTransform(i))) < 40;
+	}
+
+	// Decide in parallel from the tick state, then apply the decisions in
+	// archetype order so the result does not depend on the threads
+	ReadAI();
+	WriteAI(Bird);
+
+	// update position and rotation
+	for (int i = 0; i < hieNodeList.size(); i++) {
+		SceneNode* curr = hieNodeList[i];
+		if (curr->GetKind() == SkyboxKind) {
+			curr->SetPosition(Bird->GetPosition());
+		}
 		curr->Update();
 	}
+
+	// Propagate transforms once every node has moved, so that all world
+	// matrices of the frame are built from the same state
+	UpdateTransforms();
 }
 
 
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <functional>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -13,12 +15,35 @@
 #include "camera.h"
 #include "SkyBox.h"
 #include "common.h"
+#include "transform_store.h"
+#include "entity_store.h"
+#include "static_batch.h"
+#include "render_queue.h"
+#include "worker_pool.h"
 
 #define FRAME_BUFFER_WIDTH 1024
 #define FRAME_BUFFER_HEIGHT 768
 
 namespace game {
 
+	// World state the AI of a tick reads
+	struct AITickState {
+		glm::vec3 bird_position;
+		glm::vec3 bird_forward;
+		float bird_speed;
+		glm::vec3 suck;
+		glm::vec3 escape; // point hens run to and chickens flee from
+		bool escape_valid; // a hen has seen the bird
+	};
+
+	// What an AI entity observed during the read phase of a tick
+	struct AIDecision {
+		bool arrived; // reached its target
+		bool warned; // hen: bird close by; chicken: close to the escape point
+		bool in_suck; // inside the tornado
+		bool hit_bird; // drone collided with the bird
+	};
+
     // Class that manages all the objects in a scene
     class SceneGraph {
 
@@ -30,15 +55,66 @@ namespace game {
             //std::vector<SceneNode *> node_;
 			std::vector<SceneNode*> hieNodeList;
 
+			// Registry of every node reachable from the graph (roots and their
+			// subtrees), indexed by name and by handle
+			std::unordered_map<std::string, std::vector<SceneNode*> > nameIndex;
+			std::vector<SceneNode*> handleTable;
+			std::vector<NodeHandle> freeHandles;
+			// Generation of each handle, bumped every time the handle is released
+			std::vector<unsigned int> handleGenerations;
+
+			// World transforms of the registered nodes, addressed by node handle
+			TransformStore transforms_;
+			// Handles of nodes whose local transform must be copied to the store
+			std::vector<NodeHandle> dirtyTransforms;
+			// Nodes flagged for destruction since the last flush
+			std::vector<SceneNode*> destroyQueue;
+			// Components of the AI entities, grouped by archetype
+			EntityStore entities_;
+			// Threads shared by the per-frame passes
+			WorkerPool workers_;
+
 			GLuint frame_buffer_;
 			// Quad vertex array for drawing from texture
 			GLuint quad_array_buffer_;
+			GLuint quad_vertex_array_;
 			// Render targets
 			GLuint texture_;
 			GLuint depth_buffer_;
 
 			// inital a point thats impossible to reach
 			glm::vec3 suck = glm::vec3(999,999,999);
+
+			// Two-phase AI: decisions are computed in parallel from aiTick,
+			// then applied serially
+			AITickState aiTick;
+			std::vector<AIDecision> droneDecisions;
+			std::vector<AIDecision> henDecisions;
+			std::vector<AIDecision> chickenDecisions;
+			std::vector<std::vector<int> > missileDroneHits;
+			std::vector<std::vector<int> > missileHenHits;
+			void ReadAI(void);
+			void WriteAI(SceneNode *Bird);
+			// Split [0, count) into chunks run on the worker pool
+			void ParallelFor(int count, const std::function<void(int, int)> &range);
+
+			// Swap the last root into the slot of a root node and pop it
+			void RemoveRoot(SceneNode *node);
+			// Take a node out of its name bucket, keeping the order of the others
+			void RemoveFromBucket(SceneNode *node);
+			// Free a detached node and the subtree it owns
+			void DeleteSubtree(SceneNode *node);
+
+			// Merged geometry of the baked static nodes, one batch per
+			// material; drawn before the roots and never updated
+			std::vector<StaticBatch*> staticBatches;
+			// Draws of the frame, sorted by state
+			RenderQueue renderQueue_;
+			// Queue the draws of the scene and issue them
+			void DrawScene(Camera *camera);
+
+			// Whether a node and its whole subtree are static
+			static bool IsStaticTree(SceneNode *node);
         public:
             // Constructor and destructor
             SceneGraph(void);
@@ -53,11 +129,64 @@ namespace game {
 
             // Add an already-created node
 			void AddNode(SceneNode *node);
-			// Find a list of nodes with a specific name
-			SceneNode* GetNode(std::string node_name);
+			// Find a node with a specific name; if several nodes share the
+			// name, the first one registered is returned. Use handles or
+			// references to tell apart nodes with the same name
+			SceneNode* GetNode(const std::string &node_name) const;
+			// Find a node from its handle, NULL if the handle is not in use
+			SceneNode* GetNodeByHandle(NodeHandle handle) const;
+
+			// Reference to a registered node, valid until the node leaves the graph
+			NodeRef GetRef(SceneNode *node) const;
+			// Node of a reference, NULL if the reference is stale
+			SceneNode* Resolve(const NodeRef &ref) const;
+			template <class T> T* ResolveAs(const NodeRef &ref) const { return static_cast<T*>(Resolve(ref)); }
+
+			// Add/remove a node and its subtree to/from the registry
+			void RegisterNode(SceneNode *node);
+			void UnregisterNode(SceneNode *node);
+			// Make room for 'count' more nodes, 'roots' of them in the root
+			// list, so that registering a batch does not grow the tables
+			void ReserveNodes(int count, int roots);
+			// Move a registered node to another name bucket
+			void RenameNode(SceneNode *node, const std::string &new_name);
+			// Remove every node from the graph and free it; references to the
+			// removed nodes become stale. The static batches are kept
+			void ClearNodes(void);
+
+			// Merge the static root subtrees into pre-transformed batches and
+			// free the baked nodes; called once the scene is set up
+			void BakeStatic(void);
+			// Free the static batches
+			void ClearStatic(void);
+
+			// Queue a node to be removed and freed at the next flush
+			void QueueDestroy(SceneNode *node) { destroyQueue.push_back(node); }
+			// Nodes queued for destruction, still valid until FlushDestroyed
+			const std::vector<SceneNode*> &GetDestroyQueue(void) const { return destroyQueue; }
+			// Remove the queued nodes from the graph and free them with their subtrees
+			void FlushDestroyed(void);
+
+			// Schedule the local transform of a node to be copied to the store
+			void QueueTransform(SceneNode *node) { dirtyTransforms.push_back(node->handle_); }
+			// World matrix of a registered node
+			const glm::mat4 &GetWorldMatrix(NodeHandle handle) const { return transforms_.GetWorld(handle); }
+			// World-space bounds of a node and its subtree, as of the last Update
+			const Bounds &GetSubtreeBounds(NodeHandle handle) const { return transforms_.GetSubtreeBounds(handle); }
+			// Copy changed local transforms and recompute world matrices
+			void UpdateTransforms(void);
+			// Copy changed local transforms only, so that the store holds the
+			// current positions
+			void CopyLocalTransforms(void);
+
+			// AI entities of the registered nodes
+			EntityStore &GetEntities(void) { return entities_; }
 
             // Draw the entire scene
             void Draw(Camera *camera);
+			// Ordering of the opaque draws against overdraw
+			void SetOpaqueOrdering(OpaqueOrdering ordering) { renderQueue_.SetOpaqueOrdering(ordering); }
+			OpaqueOrdering GetOpaqueOrdering(void) const { return renderQueue_.GetOpaqueOrdering(); }
 
 			void SaveTexture(char * filename);
 
@@ -73,8 +202,7 @@ namespace game {
             void Update(void);
 
 			// Get Node list
-			std::vector<SceneNode*> GetNodeList() { return hieNodeList; }
-			void SetNodeList(std::vector<SceneNode*> n) { hieNodeList = n; }
+			const std::vector<SceneNode*> &GetNodeList() const { return hieNodeList; }
 
 			int delicious(glm::vec3 pos);
 
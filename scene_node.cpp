@@ -6,6 +6,10 @@
 #include <time.h>
 
 #include "scene_node.h"
+#include "scene_graph.h"
+#include "shader_program.h"
+#include "gl_state.h"
+#include "render_queue.h"
 
 namespace game {
 
@@ -14,6 +18,11 @@ namespace game {
 		// Set name of scene node
 		name_ = name;
 
+		geometryRes_ = geometry;
+		materialRes_ = material;
+		textureRes_ = texture;
+		envmapRes_ = envmap;
+
 		// Set geometry
 		if (geometry) {
 			if (geometry->GetType() == PointSet) {
@@ -27,7 +36,18 @@ namespace game {
 			}
 			array_buffer_ = geometry->GetArrayBuffer();
 			element_array_buffer_ = geometry->GetElementArrayBuffer();
+			vertex_array_ = geometry->GetVertexArray();
 			size_ = geometry->GetSize();
+			base_vertex_ = geometry->GetBaseVertex();
+			first_index_ = geometry->GetFirstIndex();
+			index_type_ = geometry->GetIndexType();
+			bounds_ = geometry->GetBounds();
+		}
+		else {
+			vertex_array_ = 0;
+			base_vertex_ = 0;
+			first_index_ = 0;
+			index_type_ = GL_UNSIGNED_INT;
 		}
 
 		if (material) {
@@ -37,6 +57,10 @@ namespace game {
 			}
 
 			material_ = material->GetResource();
+			depth_material_ = material->GetDepthProgram();
+		}
+		else {
+			depth_material_ = 0;
 		}
 					   
 		// Set texture
@@ -58,18 +82,17 @@ namespace game {
 		// Other attributes
 		scale_ = glm::vec3(1.0, 1.0, 1.0);
 		blending_ = false;
-		children = new std::vector<SceneNode*>();
 	}
 
 
 
 	SceneNode* SceneNode::FindIt(std::string node_name) {
-		for (int i = 0; i < children->size(); i++) {
-			if ((*children)[i]->GetName() == node_name) {
-				return (*children)[i];
+		for (SceneNode *child = firstChild; child; child = child->nextSibling) {
+			if (child->GetName() == node_name) {
+				return child;
 			}
-			else if ((*children)[i]->GetChildren()->size() > 0) {
-				SceneNode * r = (*children)[i]->FindIt(node_name);
+			else if (child->firstChild) {
+				SceneNode * r = child->FindIt(node_name);
 				if (r != NULL) {
 					return r;
 				}
@@ -82,12 +105,32 @@ SceneNode::~SceneNode(){
 }
 
 
-std::string SceneNode::GetName(void) {
+const std::string &SceneNode::GetName(void) const {
 
     return name_;
 }
 
 
+void SceneNode::SetName(std::string n) {
+
+	// Keep the name index of the registry in sync
+	if (graph_) {
+		graph_->RenameNode(this, n);
+	}
+	name_ = n;
+}
+
+
+void SceneNode::SetShouldBeDestoried(bool sb) {
+
+	// Only the first request queues the node
+	if (sb && !shouldBeDestoried && graph_) {
+		graph_->QueueDestroy(this);
+	}
+	shouldBeDestoried = sb;
+}
+
+
 glm::vec3 SceneNode::GetPosition(void) const {
 
     return position_;
@@ -105,44 +148,101 @@ glm::vec3 SceneNode::GetScale(void) const {
     return scale_;
 }
 
-glm::mat4 SceneNode::GetTransFMat()
+const glm::mat4 &SceneNode::GetTransFMat()
+{
+	static const glm::mat4 identity(1.0);
+	if (!graph_) {
+		return identity;
+	}
+	return graph_->GetWorldMatrix(handle_);
+}
+
+
+void SceneNode::MarkDirty(void)
 {
-	return transfMatrix;
+	if (!localDirty_) {
+		localDirty_ = true;
+		if (graph_) {
+			graph_->QueueTransform(this);
+		}
+	}
 }
 
 
 void SceneNode::SetPosition(glm::vec3 position){
 
     position_ = position;
+	MarkDirty();
 }
 
 
 void SceneNode::SetOrientation(glm::quat orientation){
 
     orientation_ = orientation;
+	MarkDirty();
 }
 
 
 void SceneNode::SetScale(glm::vec3 scale){
 
     scale_ = scale;
+	MarkDirty();
 }
 
 void SceneNode::SetParent(SceneNode * p)
 {
 	p->AddChild(this);
-	parent = p; 
+
+	// Nodes attached to a registered parent become reachable from the graph
+	if (p->graph_) {
+		p->graph_->RegisterNode(this);
+	}
 }
 
 void SceneNode::AddChild(SceneNode * c)
 {
-	children->push_back(c);
+	// A node is the child of one parent at a time
+	if (c->parent) {
+		c->parent->Unlink(c);
+	}
+
+	c->parent = this;
+	c->prevSibling = lastChild;
+	c->nextSibling = NULL;
+	if (lastChild) {
+		lastChild->nextSibling = c;
+	}
+	else {
+		firstChild = c;
+	}
+	lastChild = c;
+}
+
+
+void SceneNode::Unlink(SceneNode * c)
+{
+	if (c->prevSibling) {
+		c->prevSibling->nextSibling = c->nextSibling;
+	}
+	else {
+		firstChild = c->nextSibling;
+	}
+	if (c->nextSibling) {
+		c->nextSibling->prevSibling = c->prevSibling;
+	}
+	else {
+		lastChild = c->prevSibling;
+	}
+	c->parent = NULL;
+	c->nextSibling = NULL;
+	c->prevSibling = NULL;
 }
 
 
 void SceneNode::Translate(glm::vec3 trans){
 
     position_ += trans;
+	MarkDirty();
 }
 
 
@@ -150,12 +250,14 @@ void SceneNode::Rotate(glm::quat rot){
 
     orientation_ *= rot;
     orientation_ = glm::normalize(orientation_);
+	MarkDirty();
 }
 
 
 void SceneNode::Scale(glm::vec3 scale){
 
     scale_ *= scale;
+	MarkDirty();
 }
 
 
@@ -189,49 +291,30 @@ GLuint SceneNode::GetMaterial(void) const {
 }
 
 
-void SceneNode::Draw(Camera *camera){
+const Bounds &SceneNode::GetSubtreeBounds(void) const {
 
-	if (blending_) {
-		// Disable z-buffer
-		glDisable(GL_DEPTH_TEST);
-
-		// Enable blending
-		glEnable(GL_BLEND);
-		//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Simpler form
-		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glBlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
-	}
-	else {
-		// Enable z-buffer
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
+	// Nodes outside a graph (static batches) are already in world space
+	if (graph_) {
+		return graph_->GetSubtreeBounds(handle_);
 	}
+	return bounds_;
+}
 
-	// Select proper material (shader program)
-	glUseProgram(material_);
-
-	// Set geometry to draw
-	glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
-
-	// Set globals for camera
-	camera->SetupShader(material_);
 
-	// Set world matrix and other shader input variables
-	SetupShader(material_,camera);
+void SceneNode::Submit(RenderQueue *queue, Camera *camera){
 
-	// Draw geometry
-	if (mode_ == GL_POINTS) {
-		glDrawArrays(mode_, 0, size_);
+	// The skybox surrounds the camera and is never culled
+	if (kind_ != SkyboxKind && !queue->IsVisible(GetSubtreeBounds())) {
+		return;
 	}
-	else {
-		glDrawElements(mode_, size_, GL_UNSIGNED_INT, 0);
+
+	// Nodes without geometry (cameras) only hold their children
+	if (vertex_array_ && size_ > 0) {
+		queue->Add(this);
 	}
 
-	if (children->size() > 0) {
-		for (int i = 0; i < children->size(); i++) {
-			(*children)[i]->Draw(camera);
-		}
+	for (SceneNode *child = firstChild; child; child = child->nextSibling) {
+		child->Submit(queue, camera);
 	}
 }
 
@@ -240,7 +323,7 @@ void SceneNode::UpdateNodeInfo(void){
 
 	if (!constRender) { 
 		renderTime += 0.01; 
-		if (renderTime >= lifeTime)shouldBeDestoried = true;
+		if (renderTime >= lifeTime) SetShouldBeDestoried(true);
 	}
 	float theSpeed = 0;
 	stun--;
@@ -263,7 +346,7 @@ void SceneNode::UpdateNodeInfo(void){
 
 	glm::vec3 velocity = theSpeed * glm::normalize(orientation_*forward_);
 
-	if (name_ == "Camera") {
+	if (kind_ == FirstCameraKind) {
 		glm::vec3 nextPos = position_ + velocity;
 		if (nextPos.y <= -23.5) {
 			velocity.y = 0;
@@ -272,101 +355,45 @@ void SceneNode::UpdateNodeInfo(void){
 			velocity = glm::vec3(0);
 		}
 	}
-	position_ += velocity;
-
-	scalingMatrix = glm::scale(glm::mat4(1.0), scale_);
-	glm::mat4 rotation = glm::mat4_cast(orientation_);
-	glm::mat4 translation = glm::translate(glm::mat4(1.0), position_);
-	glm::mat4 origin = glm::translate(glm::mat4(1.0), -rotOrigin);
-	
-	if (parent == NULL) { transfMatrix = translation * rotation * origin * scalingMatrix; }
-	else { transfMatrix = (parent->GetTransFMat()) *  translation *  rotation * origin * scalingMatrix; }
-
-
+	if (velocity != glm::vec3(0)) {
+		position_ += velocity;
+		MarkDirty();
+	}
 }
 
 
-void SceneNode::SetupShader(GLuint program, Camera* camera){
-
-    // Set attributes for shaders
-    GLint vertex_att = glGetAttribLocation(program, "vertex");
-    glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(vertex_att);
-
-    GLint normal_att = glGetAttribLocation(program, "normal");
-    glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (3*sizeof(GLfloat)));
-    glEnableVertexAttribArray(normal_att);
-
-    GLint color_att = glGetAttribLocation(program, "color");
-    glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (6*sizeof(GLfloat)));
-    glEnableVertexAttribArray(color_att);
-
-    GLint tex_att = glGetAttribLocation(program, "uv");
-    glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11*sizeof(GLfloat), (void *) (9*sizeof(GLfloat)));
-    glEnableVertexAttribArray(tex_att);
-
-
-
-    // World transformation
-    
-
-    glm::mat4 transf = transfMatrix;
+void SceneNode::SetupShader(GLuint /* program */){
 
-	GLint world_mat = glGetUniformLocation(program, "world_mat");
-	glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(transf));
-
-
-	// Normal matrix
-	glm::mat4 normal_matrix = glm::transpose(glm::inverse(transf));
-	GLint normal_mat = glGetUniformLocation(program, "normal_mat");
-	glUniformMatrix4fv(normal_mat, 1, GL_FALSE, glm::value_ptr(normal_matrix));
-
-	// Normal matrix with view added
-	glm::mat4 normal_view_matrix = glm::transpose(glm::inverse(camera->GetCurrentViewMatrix() * transf));
-	GLint normal_view_mat = glGetUniformLocation(program, "normal_view_mat");
-	glUniformMatrix4fv(normal_view_mat, 1, GL_FALSE, glm::value_ptr(normal_view_matrix));
+    // The vertex layout comes with the vertex array of the geometry
+    // World and normal matrices are pushed by the render queue, which may
+    // draw several nodes sharing this state at once; the camera and the
+    // timer are in the frame block
 
 	// Texture
 	if (texture_) {
-		GLint tex = glGetUniformLocation(program, "texture_map");
-		glUniform1i(tex, 0); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture_); // First texture we bind
-		// Define texture interpolation
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// The map reads unit 0, set when the program was loaded
+		// Mipmaps were generated at load; filtering comes from the sampler
+		GLState::BindSampler(0, GLState::GetMipmapSampler());
+		GLState::BindTexture(0, GL_TEXTURE_2D, texture_); // First texture we bind
 	}
 
 	// Environment map
 	if (envmap_) {
-		GLint tex = glGetUniformLocation(program, "env_map");
-		glUniform1i(tex, 1); // Assign the first texture to the map
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envmap_); // First texture we bind
-		// Define texture interpolation
-		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// The map reads unit 1, set when the program was loaded
+		GLState::BindSampler(1, GLState::GetMipmapSampler());
+		GLState::BindTexture(1, GL_TEXTURE_CUBE_MAP, envmap_); // First texture we bind
 	}
-
-	// Timer
-	GLint timer_var = glGetUniformLocation(program, "timer");
-	double current_time = glfwGetTime();
-	glUniform1f(timer_var, (float)current_time);
 }
 
 void SceneNode::RemoveChild(SceneNode * child)
 {
-	std::vector<SceneNode*>::iterator it;
-	for (it = (*children).begin(); it != (*children).end();) {
-		if (child->GetName() == (*it)->GetName()) {
-			it = children->erase(it);
-		}
-		else {
-			it++;
-		}
+	if (child->parent != this) {
+		return;
+	}
+	if (child->graph_) {
+		child->graph_->UnregisterNode(child);
 	}
+	Unlink(child);
 }
 
 } // namespace game;
@@ -12,13 +12,40 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include "resource.h"
+#include "bounds.h"
 #include "camera.h"
 
 namespace game {
 
+	class SceneGraph;
+	class RenderQueue;
+
+	// Handle of a node inside the registry of its scene graph
+	typedef int NodeHandle;
+	const NodeHandle INVALID_NODE_HANDLE = -1;
+
+	// Reference to a node that can outlive it: the generation of the handle
+	// changes when the node leaves its scene graph, so a stale reference
+	// resolves to NULL instead of to a freed or reused node
+	struct NodeRef {
+		NodeHandle handle = INVALID_NODE_HANDLE;
+		unsigned int generation = 0;
+	};
+
+	// Behaviour of a node, given when the node is created
+	// The scene logic dispatches on it; names are only used for lookups
+	typedef enum Kind { GenericKind, DroneKind, HenKind, ChickenKind, MissileKind, SkyboxKind,
+		BirdBodyKind, LeftWingKind, RightWingKind,
+		FirstCameraKind, ThirdCameraKind, OverlookCameraKind } NodeKind;
+
     // Class that manages one object in a scene 
     class SceneNode {
 
+		friend class SceneGraph;
+		friend class Archetype;
+		friend class SceneSnapshot;
+		friend class RenderQueue;
+
         public:
             // Create scene node from given resources
 			SceneNode(const std::string name, const Resource *geometry, const Resource *material, const Resource *texture = NULL, const Resource *envmap = NULL);
@@ -26,11 +53,25 @@ namespace game {
 			SceneNode * FindIt(std::string node_name);
 
 			// Destructor
-            ~SceneNode();
+            virtual ~SceneNode();
 
             // Get name of node
-            std::string GetName(void);
-			void SetName(std::string n) { name_ = n; }
+            const std::string &GetName(void) const;
+			void SetName(std::string n);
+
+			// Behaviour of the node
+			NodeKind GetKind(void) const { return kind_; }
+			void SetKind(NodeKind k) { kind_ = k; }
+
+			// Static nodes never move once the scene is set up and can be
+			// baked into the static geometry of the graph
+			bool IsStatic(void) const { return static_; }
+			void SetStatic(bool s) { static_ = s; }
+
+			// Registry information, valid while the node is part of a scene graph
+			NodeHandle GetHandle(void) const { return handle_; }
+			SceneGraph* GetGraph(void) { return graph_; }
+			int GetEntitySlot(void) const { return entitySlot_; }
 
             // Get node attributes
 			virtual glm::vec3 GetPosition(void) const;
@@ -40,10 +81,11 @@ namespace game {
 			float GetMaxSpeed() { return maxSpeed; }
 			float GetFictionFactor() { return fictionFactor; }
 			glm::vec3 GetScale(void) const;
-			glm::mat4 GetTransFMat();
+			const glm::mat4 &GetTransFMat();
 			glm::vec3 GetOrigin() { return rotOrigin; }
 			SceneNode* GetParent() { return parent; }
-			std::vector <SceneNode*> * GetChildren() { return children; }
+			SceneNode* GetFirstChild() { return firstChild; }
+			SceneNode* GetNextSibling() { return nextSibling; }
 			glm::vec3 GetForward() { return orientation_ * forward_; }
 			glm::vec3 GetUp() { return orientation_ * up_; }
 			glm::vec3 GetSide() { return orientation_ * side_; }
@@ -56,8 +98,7 @@ namespace game {
 			void SetMaxSpeed(float ms) { maxSpeed = ms; }
 			void SetFictionFactor(float ff) { fictionFactor = ff; }
 			void SetScale(glm::vec3 scale);
-			void SetTransMatrix(glm::mat4 tm) { transfMatrix = tm; }
-			void SetOrigin(glm::vec3 o) { rotOrigin = o; }
+			void SetOrigin(glm::vec3 o) { rotOrigin = o; MarkDirty(); }
 			void SetParent(SceneNode* p);
 			void AddChild(SceneNode *c);
 			void SetForward(glm::vec3 f) { forward_ = f; }
@@ -68,9 +109,15 @@ namespace game {
 			virtual void Rotate(glm::quat rot);
 			void Scale(glm::vec3 scale);
 
-            // Draw the node according to scene parameters in 'camera'
-            // variable
-            virtual void Draw(Camera *camera);
+            // Queue the draws of the node and its subtree, as seen from
+            // 'camera'; subtrees outside the view are skipped whole
+            virtual void Submit(RenderQueue *queue, Camera *camera);
+
+            // Object-space bounds of the geometry of the node
+            const Bounds &GetBounds(void) const { return bounds_; }
+            // World-space bounds of the node and its subtree, as of the last
+            // update of the scene graph
+            const Bounds &GetSubtreeBounds(void) const;
 
 
 			void UpdateNodeInfo(void);
@@ -84,6 +131,10 @@ namespace game {
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
             GLsizei GetSize(void) const;
+            GLint GetBaseVertex(void) const { return base_vertex_; }
+            GLuint GetFirstIndex(void) const { return first_index_; }
+            GLenum GetIndexType(void) const { return index_type_; }
+            const Resource *GetGeometry(void) const { return geometryRes_; }
             GLuint GetMaterial(void) const;
 
 			// life time and destroy
@@ -92,27 +143,18 @@ namespace game {
 			float GetLifeTime() { return lifeTime; }
 			float GetRenderTime() { return renderTime; }
 
-			void SetShouldBeDestoried(bool sb) { shouldBeDestoried = sb; }
+			// Flagging a node queues it for destruction by its scene graph
+			void SetShouldBeDestoried(bool sb);
 			void SetRenderState(bool rs) { constRender = rs; }
 			void SetLifeTime(float lt) { lifeTime = lt; }
 			void SetRenderTiem(float rt) { renderTime = rt; }
 
+			// Detach a child of this node and remove it from the graph
 			void RemoveChild(SceneNode * child);
 
 			//getter, setter for stun
 			float getStun() { return stun; }
 			void setStun(float s) { stun = s; }
-			//getter, setter for target position
-			glm::vec3 getTarget() { return target; }
-			void setTarget(glm::vec3 t) { target = t; }
-			//getter, setter for rest time
-			float getRest() { return rest; }
-			void setRest(float r) { rest = r; }
-			//getter, setter for moving center and range
-			glm::vec3 getMoving_Center() { return moving_Center; }
-			void setMoving_Center(glm::vec3 c) { moving_Center = c; }
-			float getMoving_Range_radius() { return moving_Range_radius; }
-			void setMoving_Range_radius(float r) { moving_Range_radius = r; }
 
 
         protected:
@@ -121,11 +163,24 @@ namespace game {
 			bool blending_; // Draw with blending or not
 
             std::string name_; // Name of the scene node
+			NodeKind kind_ = GenericKind; // Behaviour of the scene node
+			bool static_ = false; // never moves after the scene is set up
             GLuint array_buffer_; // References to geometry: vertex and array buffers
             GLuint element_array_buffer_;
+            GLuint vertex_array_; // Vertex layout of the geometry, bound to draw it
             GLenum mode_; // Type of geometry
             GLsizei size_; // Number of primitives in geometry
+            GLint base_vertex_; // Range of the geometry in its buffers
+            GLuint first_index_;
+            GLenum index_type_;
+            Bounds bounds_; // Object-space bounds of geometry, empty if none
             GLuint material_; // Reference to shader program
+            GLuint depth_material_; // Depth-only variant of the program, 0 if none
+			// Resources the node was created from
+			const Resource *geometryRes_;
+			const Resource *materialRes_;
+			const Resource *textureRes_;
+			const Resource *envmapRes_;
             glm::vec3 position_; // Position of node
             glm::quat orientation_; // Orientation of node
             glm::vec3 scale_; // Scale of node
@@ -135,18 +190,35 @@ namespace game {
 			float maxSpeed = 0.3;	// max speed of general object if not specified
 			float fictionFactor = 0; // fiction force of general object if not specified
 
-            // Set matrices that transform the node in a shader program
-			virtual void SetupShader(GLuint program,Camera* camera);
+            // Bind the textures and uniforms of the node in a shader program;
+            // the render queue pushes its world matrix and the frame block
+            // holds the camera
+			virtual void SetupShader(GLuint program);
 
 
 
-			// matrixs for transform
-			glm::mat4 transfMatrix = glm::mat4(1.0);
-			glm::mat4 scalingMatrix = glm::mat4(1.0);
+			// The world matrix lives in the transform store of the scene graph,
+			// under the handle of the node
+			bool localDirty_ = true; // local transform changed since it was last copied to the store
+			// Flag the local transform so the graph copies it to its store
+			void MarkDirty(void);
 
 			// parent 
 			SceneNode* parent = NULL;
-			std::vector<SceneNode*> * children;
+			// children, as an intrusive doubly linked list of siblings
+			SceneNode* firstChild = NULL;
+			SceneNode* lastChild = NULL;
+			SceneNode* nextSibling = NULL;
+			SceneNode* prevSibling = NULL;
+			// Take a child out of the sibling list
+			void Unlink(SceneNode *c);
+
+			// scene graph registry
+			SceneGraph* graph_ = NULL;
+			NodeHandle handle_ = INVALID_NODE_HANDLE;
+			int nameSlot_ = -1; // position in the name bucket of the registry
+			int rootSlot_ = -1; // position in the root list of the graph, -1 if not a root
+			int entitySlot_ = -1; // position in the archetype of the node kind, -1 if not an entity
 					   			
 			// intial direction
 			glm::vec3 forward_ = glm::vec3(0, 0, -1);
@@ -163,19 +235,8 @@ namespace game {
 			// bool stun, only affect bird and hen. If > 0, then stun
 			float stun = -1.0;
 
-			// glm::vec3 target position, only affect for drone and hen
-			glm::vec3 target;
-			float rest = 111;//drone will stop when move to target for some time
-
-			// moving center and moving range for chicken and hen
-			glm::vec3 moving_Center = glm::vec3(0.0, -24.9, 0.0);
-			float moving_Range_radius = 130;
-
-			// how far can object move far from origin
-			float dis_from_origin = 150;
-			// ego cant reach ground
-			float min_height = -22;
-
+			// AI state of drones, hens and chickens lives in the entity store
+			// of the scene graph
     }; // class SceneNode
 
 } // namespace game
@@ -0,0 +1,379 @@
+#include <stdexcept>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "scene_snapshot.h"
+#include "camera_node.h"
+#include "SkyBox.h"
+#include "common.h"
+
+namespace game {
+
+// Layout of a snapshot:
+//   SnapshotHeader
+//   resource names, node names: int length followed by the characters
+//   SnapshotRecord for every node, parents before children
+
+static const char snapshot_magic[4] = { 'G', 'S', 'N', 'P' };
+static const int snapshot_version = 2;
+
+typedef enum SnapshotClassType { SnapshotCommon, SnapshotSkyBox, SnapshotCamera } SnapshotClass;
+
+struct SnapshotHeader {
+	char magic[4];
+	int version;
+	int num_resources;
+	int num_names;
+	int num_nodes;
+};
+
+struct SnapshotRecord {
+	int node_class;
+	int kind;
+	int name;
+	int geometry, material, texture, envmap; // resource name indices, -1 for none
+	int parent; // record index of the parent, -1 for a root
+	int listed; // in the root list of the graph
+	int is_static; // baked with the static geometry
+
+	glm::vec3 position;
+	glm::quat orientation;
+	glm::vec3 scale;
+	glm::vec3 origin;
+	glm::vec3 forward;
+	float speed, acceleration, max_speed, fiction_factor;
+	int const_render;
+	float life_time, render_time, stun;
+
+	// Common
+	float angle, angle_speed, rot_range;
+	glm::vec3 rot_axis;
+	float offset, trans_range, trans_speed;
+	glm::vec3 trans_axis;
+	float melee, fire, stunned;
+
+	// AI
+	int has_ai;
+	AIState ai;
+
+	// CameraNode
+	Camera::State camera;
+};
+
+
+// Index of a string in a table, adding it if needed
+static int TableIndex(std::vector<std::string> &table, std::unordered_map<std::string, int> &index, const std::string &s) {
+
+	std::unordered_map<std::string, int>::iterator it = index.find(s);
+	if (it != index.end()) {
+		return it->second;
+	}
+	int i = (int)table.size();
+	table.push_back(s);
+	index[s] = i;
+	return i;
+}
+
+
+static void Append(std::vector<char> &data, const void *bytes, size_t size) {
+
+	const char *p = (const char *)bytes;
+	data.insert(data.end(), p, p + size);
+}
+
+
+static void Read(const std::vector<char> &data, size_t &offset, void *bytes, size_t size) {
+
+	if (offset + size > data.size()) {
+		throw(std::ios_base::failure(std::string("Truncated scene snapshot")));
+	}
+	memcpy(bytes, &data[offset], size);
+	offset += size;
+}
+
+
+static void ReadTable(const std::vector<char> &data, size_t &offset, int count, std::vector<std::string> &table) {
+
+	table.resize(count);
+	for (int i = 0; i < count; i++) {
+		int length;
+		Read(data, offset, &length, sizeof(length));
+		if (length < 0 || offset + length > data.size()) {
+			throw(std::ios_base::failure(std::string("Truncated scene snapshot")));
+		}
+		table[i].assign(data.begin() + offset, data.begin() + offset + length);
+		offset += length;
+	}
+}
+
+
+SceneSnapshot::SceneSnapshot(void) {
+}
+
+
+SceneSnapshot::~SceneSnapshot() {
+}
+
+
+void SceneSnapshot::Capture(SceneGraph *scene) {
+
+	std::vector<std::string> resources, names;
+	std::unordered_map<std::string, int> resource_index, name_index;
+	std::vector<SnapshotRecord> records;
+
+	// Depth-first from the roots that have no parent, so that parents are
+	// recorded before their children; (node, parent record) pairs
+	std::vector<std::pair<SceneNode*, int> > stack;
+	const std::vector<SceneNode*> &roots = scene->GetNodeList();
+	for (int r = (int)roots.size() - 1; r >= 0; r--) {
+		if (!roots[r]->GetParent()) {
+			stack.push_back(std::make_pair(roots[r], -1));
+		}
+	}
+
+	while (!stack.empty()) {
+		SceneNode *node = stack.back().first;
+		int parent = stack.back().second;
+		stack.pop_back();
+
+		// Only the persistent node classes are captured
+		SnapshotClass node_class;
+		Common *common = dynamic_cast<Common *>(node);
+		CameraNode *camera = dynamic_cast<CameraNode *>(node);
+		if (camera) {
+			node_class = SnapshotCamera;
+		}
+		else if (dynamic_cast<SkyBox *>(node)) {
+			node_class = SnapshotSkyBox;
+		}
+		else if (common && node->GetKind() != MissileKind) {
+			node_class = SnapshotCommon;
+		}
+		else {
+			continue;
+		}
+		if (node->GetShouldBeDestoried()) {
+			continue;
+		}
+
+		SnapshotRecord rec = SnapshotRecord();
+		rec.node_class = node_class;
+		rec.kind = node->kind_;
+		rec.name = TableIndex(names, name_index, node->name_);
+		const Resource *res[4] = { node->geometryRes_, node->materialRes_, node->textureRes_, node->envmapRes_ };
+		int *res_field[4] = { &rec.geometry, &rec.material, &rec.texture, &rec.envmap };
+		for (int i = 0; i < 4; i++) {
+			*res_field[i] = res[i] ? TableIndex(resources, resource_index, res[i]->GetName()) : -1;
+		}
+		rec.parent = parent;
+		rec.listed = node->rootSlot_ >= 0;
+		rec.is_static = node->static_;
+
+		rec.position = node->position_;
+		rec.orientation = node->orientation_;
+		rec.scale = node->scale_;
+		rec.origin = node->rotOrigin;
+		rec.forward = node->forward_;
+		rec.speed = node->speed;
+		rec.acceleration = node->acceleration_;
+		rec.max_speed = node->maxSpeed;
+		rec.fiction_factor = node->fictionFactor;
+		rec.const_render = node->constRender;
+		rec.life_time = node->lifeTime;
+		rec.render_time = node->renderTime;
+		rec.stun = node->stun;
+
+		if (node_class == SnapshotCommon) {
+			rec.angle = common->GetAngle();
+			rec.angle_speed = common->GetAngleSpeed();
+			rec.rot_axis = common->GetRotAxis();
+			rec.rot_range = common->GetRotRange();
+			rec.offset = common->GetOffset();
+			rec.trans_axis = common->GetTransAxis();
+			rec.trans_range = common->GetTransRange();
+			rec.trans_speed = common->GetTransSpeed();
+			rec.melee = common->getMAnimation();
+			rec.fire = common->getFAnimation();
+			rec.stunned = common->getSAnimation();
+		}
+
+		AIState *ai = scene->GetEntities().GetAI(node);
+		if (ai) {
+			rec.has_ai = 1;
+			rec.ai = *ai;
+		}
+
+		if (node_class == SnapshotCamera) {
+			rec.camera = camera->GetCamera()->GetState();
+		}
+
+		int index = (int)records.size();
+		records.push_back(rec);
+
+		// Push in reverse so that children keep their order
+		std::vector<std::pair<SceneNode*, int> >::size_type mark = stack.size();
+		for (SceneNode *child = node->firstChild; child; child = child->nextSibling) {
+			stack.push_back(std::make_pair(child, index));
+		}
+		std::reverse(stack.begin() + mark, stack.end());
+	}
+
+	// Pack everything in one buffer
+	SnapshotHeader header;
+	memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+	header.version = snapshot_version;
+	header.num_resources = (int)resources.size();
+	header.num_names = (int)names.size();
+	header.num_nodes = (int)records.size();
+
+	data_.clear();
+	Append(data_, &header, sizeof(header));
+	for (int t = 0; t < 2; t++) {
+		const std::vector<std::string> &table = t == 0 ? resources : names;
+		for (size_t i = 0; i < table.size(); i++) {
+			int length = (int)table[i].size();
+			Append(data_, &length, sizeof(length));
+			Append(data_, table[i].data(), length);
+		}
+	}
+	if (!records.empty()) {
+		Append(data_, &records[0], records.size() * sizeof(SnapshotRecord));
+	}
+}
+
+
+void SceneSnapshot::Restore(SceneGraph *scene, const ResourceManager *resman) const {
+
+	size_t offset = 0;
+	SnapshotHeader header;
+	Read(data_, offset, &header, sizeof(header));
+	if (memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0 || header.version != snapshot_version) {
+		throw(std::ios_base::failure(std::string("Invalid scene snapshot")));
+	}
+
+	// Resolve every resource once
+	std::vector<std::string> resource_names, names;
+	ReadTable(data_, offset, header.num_resources, resource_names);
+	ReadTable(data_, offset, header.num_names, names);
+	std::vector<const Resource *> resources(resource_names.size());
+	for (size_t i = 0; i < resource_names.size(); i++) {
+		resources[i] = resman->GetResource(resource_names[i]);
+		if (!resources[i]) {
+			throw(std::invalid_argument(std::string("Could not find resource \"") + resource_names[i] + std::string("\"")));
+		}
+	}
+
+	if (offset + header.num_nodes * sizeof(SnapshotRecord) > data_.size()) {
+		throw(std::ios_base::failure(std::string("Truncated scene snapshot")));
+	}
+
+	scene->ClearNodes();
+
+	std::vector<SceneNode*> nodes(header.num_nodes);
+	for (int i = 0; i < header.num_nodes; i++) {
+		// Records may not be aligned in the buffer
+		SnapshotRecord rec;
+		memcpy((void *)&rec, &data_[offset + i * sizeof(SnapshotRecord)], sizeof(rec));
+		int num_resources = (int)resources.size();
+		if (rec.name < 0 || rec.name >= (int)names.size() || rec.parent >= i ||
+			rec.geometry >= num_resources || rec.material >= num_resources || rec.texture >= num_resources || rec.envmap >= num_resources) {
+			throw(std::ios_base::failure(std::string("Invalid scene snapshot")));
+		}
+		const std::string &name = names[rec.name];
+		const Resource *geometry = rec.geometry >= 0 ? resources[rec.geometry] : NULL;
+		const Resource *material = rec.material >= 0 ? resources[rec.material] : NULL;
+		const Resource *texture = rec.texture >= 0 ? resources[rec.texture] : NULL;
+		const Resource *envmap = rec.envmap >= 0 ? resources[rec.envmap] : NULL;
+
+		SceneNode *node;
+		if (rec.node_class == SnapshotCamera) {
+			Camera *camera = new Camera();
+			camera->SetState(rec.camera);
+			node = new CameraNode(camera, name);
+		}
+		else if (rec.node_class == SnapshotSkyBox) {
+			node = new SkyBox(name, geometry, material, texture, envmap);
+		}
+		else {
+			Common *common = new Common(name, geometry, material, texture, envmap);
+			common->SetAngle(rec.angle);
+			common->SetAngleSpeed(rec.angle_speed);
+			common->SetRotAxis(rec.rot_axis);
+			common->SetRotRange(rec.rot_range);
+			common->SetOffset(rec.offset);
+			common->SetTransAxis(rec.trans_axis);
+			common->SetTransRange(rec.trans_range);
+			common->SetTransSpeed(rec.trans_speed);
+			common->setMAnimation(rec.melee);
+			common->setFAnimation(rec.fire);
+			common->setSAnimation(rec.stunned);
+			node = common;
+		}
+
+		node->kind_ = (NodeKind)rec.kind;
+		node->static_ = rec.is_static != 0;
+		node->position_ = rec.position;
+		node->orientation_ = rec.orientation;
+		node->scale_ = rec.scale;
+		node->rotOrigin = rec.origin;
+		node->forward_ = rec.forward;
+		node->speed = rec.speed;
+		node->acceleration_ = rec.acceleration;
+		node->maxSpeed = rec.max_speed;
+		node->fictionFactor = rec.fiction_factor;
+		node->constRender = rec.const_render != 0;
+		node->lifeTime = rec.life_time;
+		node->renderTime = rec.render_time;
+		node->stun = rec.stun;
+
+		// Parents were restored first
+		if (rec.parent >= 0) {
+			node->SetParent(nodes[rec.parent]);
+		}
+		if (rec.parent < 0 || rec.listed) {
+			scene->AddNode(node);
+		}
+
+		AIState *ai = scene->GetEntities().GetAI(node);
+		if (ai && rec.has_ai) {
+			*ai = rec.ai;
+		}
+		nodes[i] = node;
+	}
+}
+
+
+void SceneSnapshot::Save(const std::string &filename) const {
+
+	std::ofstream f;
+	f.open(filename.c_str(), std::ios::binary);
+	if (f.fail()) {
+		throw(std::ios_base::failure(std::string("Error opening file ") + filename));
+	}
+	if (!data_.empty()) {
+		f.write(&data_[0], data_.size());
+	}
+	f.close();
+}
+
+
+void SceneSnapshot::Load(const std::string &filename) {
+
+	// Read the whole file at once, it is parsed from memory on restore
+	std::ifstream f;
+	f.open(filename.c_str(), std::ios::binary | std::ios::ate);
+	if (f.fail()) {
+		throw(std::ios_base::failure(std::string("Error opening file ") + filename));
+	}
+	std::streamsize size = f.tellg();
+	f.seekg(0, std::ios::beg);
+	data_.resize((size_t)size);
+	if (size > 0 && !f.read(&data_[0], size)) {
+		throw(std::ios_base::failure(std::string("Error reading file ") + filename));
+	}
+	f.close();
+}
+
+} // namespace game
@@ -0,0 +1,43 @@
+#ifndef SCENE_SNAPSHOT_H_
+#define SCENE_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+
+#include "scene_graph.h"
+#include "resource_manager.h"
+
+namespace game {
+
+	// Compact binary copy of the nodes of a scene graph
+	// A snapshot holds a table of the resource names used by the scene
+	// followed by one fixed-size record per node (class, kind, transform,
+	// movement, animation, AI and camera state). Restoring reads the buffer
+	// in one pass, resolving each resource name only once
+	// Transient nodes (particles, missiles) are not captured, and neither
+	// are the static batches, which a restore leaves in place
+	class SceneSnapshot {
+
+	public:
+		SceneSnapshot(void);
+		~SceneSnapshot();
+
+		// Copy the nodes of a scene into the snapshot
+		void Capture(SceneGraph *scene);
+		// Replace the nodes of a scene with the ones of the snapshot
+		void Restore(SceneGraph *scene, const ResourceManager *resman) const;
+
+		// Write/read the snapshot to/from a file
+		void Save(const std::string &filename) const;
+		void Load(const std::string &filename);
+
+		bool IsEmpty(void) const { return data_.empty(); }
+
+	private:
+		std::vector<char> data_;
+
+	}; // class SceneSnapshot
+
+} // namespace game
+
+#endif // SCENE_SNAPSHOT_H_
@@ -1,10 +1,15 @@
-#version 130
+#version 140
 
 // Passed from the vertex shader
 in vec2 uv0;
 
-// Passed from outside
-uniform float timer;
+// Passed from outside; the timer is in the per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 uniform sampler2D texture_map;
 uniform int type;
 
@@ -0,0 +1,139 @@
+#include "shader_program.h"
+
+namespace game {
+
+std::vector<ShaderProgram*> ShaderProgram::programs_;
+
+
+ShaderProgram::ShaderProgram(GLuint program) {
+
+	program_ = program;
+
+	GLint count, max_length;
+	GLint size;
+	GLenum type;
+
+	// Attributes
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+	std::vector<GLchar> name(max_length + 1);
+	for (GLint i = 0; i < count; i++) {
+		glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+		attributes_[name.data()] = glGetAttribLocation(program, name.data());
+	}
+
+	// Uniforms; arrays are reported as "name[0]" and kept as "name"
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	name.resize(max_length + 1);
+	for (GLint i = 0; i < count; i++) {
+		glGetActiveUniform(program, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+		GLint location = glGetUniformLocation(program, name.data());
+		std::string uniform = name.data();
+		size_t bracket = uniform.find('[');
+		if (bracket != std::string::npos) {
+			uniform = uniform.substr(0, bracket);
+		}
+		uniforms_[uniform] = location;
+	}
+
+	locations_.vertex = GetAttribLocation("vertex");
+	locations_.normal = GetAttribLocation("normal");
+	locations_.color = GetAttribLocation("color");
+	locations_.uv = GetAttribLocation("uv");
+	locations_.position = GetAttribLocation("position");
+	locations_.texture_map = GetUniformLocation("texture_map");
+	locations_.env_map = GetUniformLocation("env_map");
+	locations_.flag = GetUniformLocation("flag");
+	locations_.type = GetUniformLocation("type");
+
+	// Texture units never change for a program: texture_map reads unit 0
+	// and env_map unit 1
+	glUseProgram(program);
+	if (locations_.texture_map >= 0) {
+		glUniform1i(locations_.texture_map, 0);
+	}
+	if (locations_.env_map >= 0) {
+		glUniform1i(locations_.env_map, 1);
+	}
+	glUseProgram(0);
+}
+
+
+const ShaderProgram *ShaderProgram::Register(GLuint program) {
+
+	if (program >= programs_.size()) {
+		programs_.resize(program + 1, NULL);
+	}
+	delete programs_[program];
+	programs_[program] = new ShaderProgram(program);
+	return programs_[program];
+}
+
+
+void ShaderProgram::CopyUniforms(GLuint from, GLuint to) {
+
+	GLint count, max_length;
+	GLint size;
+	GLenum type;
+	glGetProgramiv(to, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(to, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	std::vector<GLchar> name(max_length + 1);
+
+	glUseProgram(to);
+	for (GLint i = 0; i < count; i++) {
+		glGetActiveUniform(to, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+		// Members of uniform blocks have no location
+		GLint source = glGetUniformLocation(from, name.data());
+		GLint target = glGetUniformLocation(to, name.data());
+		if (source < 0 || target < 0 || size != 1) {
+			continue;
+		}
+
+		GLfloat f[16];
+		GLint n[4];
+		switch (type) {
+		case GL_FLOAT: glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+		case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+		case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+		case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+		case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+		case GL_INT: case GL_BOOL: glGetUniformiv(from, source, n); glUniform1iv(target, 1, n); break;
+		default: break;
+		}
+	}
+	glUseProgram(0);
+}
+
+
+const ShaderProgram *ShaderProgram::Find(GLuint program) {
+
+	if (program >= programs_.size()) {
+		return NULL;
+	}
+	return programs_[program];
+}
+
+
+const ShaderLocations &ShaderProgram::GetLocations(GLuint program) {
+
+	static const ShaderLocations none = { -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+	const ShaderProgram *reflected = Find(program);
+	return reflected ? reflected->locations_ : none;
+}
+
+
+GLint ShaderProgram::GetAttribLocation(const std::string &name) const {
+
+	std::unordered_map<std::string, GLint>::const_iterator it = attributes_.find(name);
+	return it == attributes_.end() ? -1 : it->second;
+}
+
+
+GLint ShaderProgram::GetUniformLocation(const std::string &name) const {
+
+	std::unordered_map<std::string, GLint>::const_iterator it = uniforms_.find(name);
+	return it == uniforms_.end() ? -1 : it->second;
+}
+
+} // namespace game
@@ -0,0 +1,75 @@
+#ifndef SHADER_PROGRAM_H_
+#define SHADER_PROGRAM_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+	// Attribute locations bound to every program before it is linked, so
+	// that one vertex array object works with any program
+	const GLuint VERTEX_ATTRIB = 0; // "vertex", or "position" for screen-space quads
+	const GLuint NORMAL_ATTRIB = 1;
+	const GLuint COLOR_ATTRIB = 2;
+	const GLuint UV_ATTRIB = 3;
+	// Per instance rather than per vertex; a matrix takes four locations
+	const GLuint WORLD_MAT_ATTRIB = 4; // "world_mat"
+	const GLuint NORMAL_MAT_ATTRIB = 8; // "normal_mat"
+
+	// Locations of the inputs the draw paths set, -1 if the program does not use one
+	struct ShaderLocations {
+		// Attributes
+		GLint vertex;
+		GLint normal;
+		GLint color;
+		GLint uv;
+		GLint position; // screen-space quad
+		// Uniforms outside of the frame block
+		GLint texture_map;
+		GLint env_map;
+		GLint flag;
+		GLint type;
+	};
+
+	// Active attributes and uniforms of a linked shader program
+	// Programs are reflected once when they are loaded, so that drawing only
+	// reads cached locations instead of querying the driver
+	class ShaderProgram {
+
+	public:
+		// Reflect a linked program and add it to the table of programs
+		static const ShaderProgram *Register(GLuint program);
+		// Reflected program of an OpenGL program, NULL if it was not registered
+		static const ShaderProgram *Find(GLuint program);
+		// Cached locations of a program; all -1 if it was not registered
+		static const ShaderLocations &GetLocations(GLuint program);
+		// Give the plain uniforms of 'to' the current values of the uniforms
+		// of the same name in 'from'
+		static void CopyUniforms(GLuint from, GLuint to);
+
+		GLuint GetProgram(void) const { return program_; }
+		const ShaderLocations &GetLocations(void) const { return locations_; }
+
+		// Location of any active attribute/uniform, -1 if there is none with that name
+		GLint GetAttribLocation(const std::string &name) const;
+		GLint GetUniformLocation(const std::string &name) const;
+
+	private:
+		ShaderProgram(GLuint program);
+
+		GLuint program_;
+		std::unordered_map<std::string, GLint> attributes_;
+		std::unordered_map<std::string, GLint> uniforms_;
+		ShaderLocations locations_;
+
+		// Registered programs, indexed by OpenGL program
+		static std::vector<ShaderProgram*> programs_;
+
+	}; // class ShaderProgram
+
+} // namespace game
+
+#endif // SHADER_PROGRAM_H_
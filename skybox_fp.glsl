@@ -1,4 +1,4 @@
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec3 uvw_interp;
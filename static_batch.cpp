@@ -0,0 +1,106 @@
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "static_batch.h"
+#include "vertex_layout.h"
+#include "uniform_blocks.h"
+
+namespace game {
+
+StaticBatch::StaticBatch(GLuint material, GLuint depth_material, GLuint texture, GLuint envmap) : SceneNode("StaticBatch", NULL, NULL) {
+
+	mode_ = GL_TRIANGLES;
+	material_ = material;
+	depth_material_ = depth_material;
+	texture_ = texture;
+	envmap_ = envmap;
+	array_buffer_ = 0;
+	element_array_buffer_ = 0;
+	vertex_array_ = 0;
+	size_ = 0;
+}
+
+
+StaticBatch::~StaticBatch() {
+
+	if (vertex_array_) {
+		glDeleteVertexArrays(1, &vertex_array_);
+	}
+	if (array_buffer_) {
+		glDeleteBuffers(1, &array_buffer_);
+	}
+	if (element_array_buffer_) {
+		glDeleteBuffers(1, &element_array_buffer_);
+	}
+}
+
+
+void StaticBatch::AddGeometry(SceneNode *node, const glm::mat4 &world) {
+
+	const int stride = SOURCE_VERTEX_FLOATS;
+
+	// Bake from the copy of the mesh kept on the CPU: the arena holds it
+	// quantized, and reading it back would stall on the GPU
+	const Resource *geometry = node->GetGeometry();
+	if (!geometry || geometry->GetSourceFaces().empty()) {
+		return;
+	}
+	const std::vector<GLfloat> &vertex = geometry->GetSourceVertices();
+	const std::vector<GLuint> &face = geometry->GetSourceFaces();
+
+	// Move the vertices to world space
+	glm::mat3 normal_matrix = glm::mat3(glm::inverseTranspose(world));
+	GLuint base = (GLuint)(vertices_.size() / stride);
+	for (size_t v = 0; v + stride <= vertex.size(); v += stride) {
+		glm::vec3 position = glm::vec3(world * glm::vec4(vertex[v], vertex[v + 1], vertex[v + 2], 1.0));
+		glm::vec3 normal = normal_matrix * glm::vec3(vertex[v + 3], vertex[v + 4], vertex[v + 5]);
+		if (glm::length(normal) > 0) {
+			normal = glm::normalize(normal);
+		}
+		bounds_.Extend(position);
+		vertices_.push_back(position.x);
+		vertices_.push_back(position.y);
+		vertices_.push_back(position.z);
+		vertices_.push_back(normal.x);
+		vertices_.push_back(normal.y);
+		vertices_.push_back(normal.z);
+		vertices_.insert(vertices_.end(), vertex.begin() + v + 6, vertex.begin() + v + stride);
+	}
+	for (size_t i = 0; i < face.size(); i++) {
+		faces_.push_back(base + face[i]);
+	}
+}
+
+
+void StaticBatch::Finish(void) {
+
+	// Packed like the meshes of the geometry arena, in buffers of its own
+	GLsizei vertex_count = (GLsizei)(vertices_.size() / SOURCE_VERTEX_FLOATS);
+	const VertexFormat &format = PackedFormat(vertices_.data(), vertex_count);
+	std::vector<unsigned char> packed(vertex_count * format.stride);
+	format.pack(vertices_.data(), vertex_count, packed.data());
+
+	glGenVertexArrays(1, &vertex_array_);
+	glBindVertexArray(vertex_array_);
+
+	glGenBuffers(1, &array_buffer_);
+	glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+	format.setup();
+	UniformBlocks::SetupObjects();
+
+	index_type_ = IndexType(vertex_count);
+	PackIndices(faces_.data(), (GLsizei)faces_.size(), index_type_, packed);
+	glGenBuffers(1, &element_array_buffer_);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+	// Unbind first, so that later buffer bindings do not change the layout
+	glBindVertexArray(0);
+	size_ = (GLsizei)faces_.size();
+
+	// The data now lives on the GPU
+	std::vector<GLfloat>().swap(vertices_);
+	std::vector<GLuint>().swap(faces_);
+}
+
+} // namespace game
@@ -0,0 +1,38 @@
+#ifndef STATIC_BATCH_H_
+#define STATIC_BATCH_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "scene_node.h"
+
+namespace game {
+
+	// Geometry of static nodes that share a material, merged into one mesh
+	// whose vertices are already in world space. The batch is drawn with an
+	// identity world matrix and has no per-tick update; its bounds are in
+	// world space too
+	class StaticBatch : public SceneNode {
+
+	public:
+		StaticBatch(GLuint material, GLuint depth_material, GLuint texture, GLuint envmap);
+		~StaticBatch();
+
+		// Append the triangles of a node, transformed by its world matrix
+		void AddGeometry(SceneNode *node, const glm::mat4 &world);
+		// Upload the merged geometry to new buffers
+		void Finish(void);
+
+		virtual void Update(void) {};
+
+	private:
+		std::vector<GLfloat> vertices_;
+		std::vector<GLuint> faces_;
+
+	}; // class StaticBatch
+
+} // namespace game
+
+#endif // STATIC_BATCH_H_
@@ -1,4 +1,4 @@
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec3 position_interp;
@@ -21,7 +21,7 @@ float Ia = 0.2; // Ambient light amount
 vec3 Dir_light = vec3(0, -20, 0);
 
 // Toon shadering
-varying float lightIntensity;
+in float lightIntensity;
 
 void main() 
 {
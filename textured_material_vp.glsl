@@ -1,16 +1,20 @@
-#version 130
+#version 140
 
 // Vertex buffer
 in vec3 vertex;
 in vec3 normal;
 in vec3 color;
 in vec2 uv;
-
-// Uniform (global) buffer
-uniform mat4 world_mat;
-uniform mat4 view_mat;
-uniform mat4 projection_mat;
-uniform mat4 normal_mat;
+in mat4 world_mat; // per instance
+in mat4 normal_mat;
+
+// Uniform (global) buffer: per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 uniform float eye_x;
 uniform float eye_y;
 uniform float eye_z;
@@ -25,16 +29,21 @@ out vec2 uv_interp;
 out vec3 light_pos;
 
 out vec3 eye_position;
+invariant gl_Position;
 
 // Material attributes (constants)
 uniform vec3 light_position = vec3(-0.5, -0.5, 1.5);
 
-varying float lightIntensity;
+out float lightIntensity;
 
 void main()
 {
 	eye_position = vec3(eye_x,eye_y,eye_z);
 
+    // The silhouette test reads these, so they are written first
+    position_interp = vec3(view_mat * world_mat * vec4(vertex, 1.0));
+    
+    normal_interp = vec3(normal_mat * vec4(normal, 0.0));
 
 	const float bias = 0.6;
 
@@ -59,10 +68,6 @@ void main()
 		gl_Position = projection_mat * view_mat * world_mat * vec4(vertex, 1.0);
 	}
 
-    position_interp = vec3(view_mat * world_mat * vec4(vertex, 1.0));
-    
-    normal_interp = vec3(normal_mat * vec4(normal, 0.0));
-
     color_interp = vec4(color, 1.0);
 
     uv_interp = uv;
@@ -1,6 +1,6 @@
 // Illumination based on the traditional three-term model
 
-#version 130
+#version 140
 
 // Attributes passed from the vertex shader
 in vec3 position_interp;
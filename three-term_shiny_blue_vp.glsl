@@ -1,22 +1,27 @@
 // Illumination based on the traditional three-term model
 
-#version 130
+#version 140
 
 // Vertex buffer
 in vec3 vertex;
 in vec3 normal;
 in vec3 color;
+in mat4 world_mat; // per instance
+in mat4 normal_mat;
 
-// Uniform (global) buffer
-uniform mat4 world_mat;
-uniform mat4 view_mat;
-uniform mat4 projection_mat;
-uniform mat4 normal_mat;
+// Uniform (global) buffer: per-frame block
+layout(std140) uniform FrameBlock {
+    mat4 view_mat;
+    mat4 projection_mat;
+    vec3 camera_pos;
+    float timer;
+};
 
 // Attributes forwarded to the fragment shader
 out vec3 position_interp;
 out vec3 normal_interp;
 out vec3 light_pos;
+invariant gl_Position;
 
 // Material attributes (constants)
 //
@@ -0,0 +1,350 @@
+#include <algorithm>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "transform_store.h"
+
+namespace game {
+
+TransformStore::TransformStore(void) {
+
+	order_dirty_ = false;
+	parallel_threshold_ = 4096;
+}
+
+
+TransformStore::~TransformStore() {
+}
+
+
+bool TransformStore::Contains(int slot) const {
+
+	return slot >= 0 && slot < (int)slot_index_.size() && slot_index_[slot] >= 0;
+}
+
+
+void TransformStore::Reserve(int count, int max_slot) {
+
+	if (max_slot >= (int)slot_index_.size()) {
+		slot_index_.reserve(max_slot + 1);
+		slot_parent_.reserve(max_slot + 1);
+	}
+	size_t size = slot_.size() + count;
+	slot_.reserve(size);
+	parent_.reserve(size);
+	position_.reserve(size);
+	orientation_.reserve(size);
+	scale_.reserve(size);
+	origin_.reserve(size);
+	local_.reserve(size);
+	world_.reserve(size);
+	bounds_.reserve(size);
+	world_bounds_.reserve(size);
+	subtree_bounds_.reserve(size);
+	dirty_.reserve(size);
+	changed_.reserve(size);
+}
+
+
+void TransformStore::Insert(int slot, int parent_slot) {
+
+	if (slot >= (int)slot_index_.size()) {
+		slot_index_.resize(slot + 1, -1);
+		slot_parent_.resize(slot + 1, -1);
+	}
+	if (slot_index_[slot] >= 0) {
+		SetParent(slot, parent_slot);
+		return;
+	}
+
+	// New transforms are appended; Rebuild moves them after their parent
+	slot_index_[slot] = (int)slot_.size();
+	slot_parent_[slot] = parent_slot;
+	slot_.push_back(slot);
+	parent_.push_back(-1);
+	position_.push_back(glm::vec3(0.0));
+	orientation_.push_back(glm::quat());
+	scale_.push_back(glm::vec3(1.0));
+	origin_.push_back(glm::vec3(0.0));
+	local_.push_back(glm::mat4(1.0));
+	world_.push_back(glm::mat4(1.0));
+	bounds_.push_back(Bounds());
+	world_bounds_.push_back(Bounds());
+	subtree_bounds_.push_back(Bounds());
+	dirty_.push_back(1);
+	changed_.push_back(0);
+	order_dirty_ = true;
+}
+
+
+void TransformStore::Remove(int slot) {
+
+	if (!Contains(slot)) {
+		return;
+	}
+
+	// Swap the last packed transform into the freed position
+	int index = slot_index_[slot];
+	int last = (int)slot_.size() - 1;
+	if (index != last) {
+		slot_[index] = slot_[last];
+		position_[index] = position_[last];
+		orientation_[index] = orientation_[last];
+		scale_[index] = scale_[last];
+		origin_[index] = origin_[last];
+		local_[index] = local_[last];
+		world_[index] = world_[last];
+		bounds_[index] = bounds_[last];
+		world_bounds_[index] = world_bounds_[last];
+		subtree_bounds_[index] = subtree_bounds_[last];
+		dirty_[index] = dirty_[last];
+		changed_[index] = changed_[last];
+		slot_index_[slot_[index]] = index;
+	}
+	slot_.pop_back();
+	parent_.pop_back();
+	position_.pop_back();
+	orientation_.pop_back();
+	scale_.pop_back();
+	origin_.pop_back();
+	local_.pop_back();
+	world_.pop_back();
+	bounds_.pop_back();
+	world_bounds_.pop_back();
+	subtree_bounds_.pop_back();
+	dirty_.pop_back();
+	changed_.pop_back();
+
+	slot_index_[slot] = -1;
+	slot_parent_[slot] = -1;
+	order_dirty_ = true;
+}
+
+
+void TransformStore::SetParent(int slot, int parent_slot) {
+
+	if (!Contains(slot) || slot_parent_[slot] == parent_slot) {
+		return;
+	}
+	slot_parent_[slot] = parent_slot;
+	dirty_[slot_index_[slot]] = 1;
+	order_dirty_ = true;
+}
+
+
+void TransformStore::SetLocal(int slot, const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale, const glm::vec3 &origin) {
+
+	int index = slot_index_[slot];
+	position_[index] = position;
+	orientation_[index] = orientation;
+	scale_[index] = scale;
+	origin_[index] = origin;
+	dirty_[index] = 1;
+}
+
+
+const glm::mat4 &TransformStore::GetWorld(int slot) const {
+
+	static const glm::mat4 identity(1.0);
+	if (!Contains(slot)) {
+		return identity;
+	}
+	return world_[slot_index_[slot]];
+}
+
+
+void TransformStore::SetBounds(int slot, const Bounds &bounds) {
+
+	int index = slot_index_[slot];
+	bounds_[index] = bounds;
+	dirty_[index] = 1;
+}
+
+
+const Bounds &TransformStore::GetSubtreeBounds(int slot) const {
+
+	static const Bounds infinite = Bounds::Infinite();
+	if (!Contains(slot)) {
+		return infinite;
+	}
+	return subtree_bounds_[slot_index_[slot]];
+}
+
+
+void TransformStore::Clear(void) {
+
+	slot_index_.clear();
+	slot_parent_.clear();
+	slot_.clear();
+	parent_.clear();
+	position_.clear();
+	orientation_.clear();
+	scale_.clear();
+	origin_.clear();
+	local_.clear();
+	world_.clear();
+	bounds_.clear();
+	world_bounds_.clear();
+	subtree_bounds_.clear();
+	dirty_.clear();
+	changed_.clear();
+	root_begin_.clear();
+	order_dirty_ = false;
+}
+
+
+void TransformStore::Rebuild(void) {
+
+	int num = (int)slot_.size();
+	int num_slots = (int)slot_index_.size();
+
+	// Child lists per slot, kept in packed order
+	std::vector<int> first_child(num_slots, -1);
+	std::vector<int> next_sibling(num_slots, -1);
+	std::vector<int> roots;
+	for (int i = num - 1; i >= 0; i--) {
+		int s = slot_[i];
+		int p = slot_parent_[s];
+		if (Contains(p)) {
+			next_sibling[s] = first_child[p];
+			first_child[p] = s;
+		}
+	}
+	for (int i = 0; i < num; i++) {
+		if (!Contains(slot_parent_[slot_[i]])) {
+			roots.push_back(slot_[i]);
+		}
+	}
+
+	// Depth-first order: parents first, each root subtree contiguous
+	std::vector<int> order;
+	order.reserve(num);
+	root_begin_.clear();
+	std::vector<int> stack;
+	for (size_t r = 0; r < roots.size(); r++) {
+		root_begin_.push_back((int)order.size());
+		stack.push_back(roots[r]);
+		while (!stack.empty()) {
+			int s = stack.back();
+			stack.pop_back();
+			order.push_back(s);
+			// Push in reverse so that children keep their order
+			std::vector<int>::size_type mark = stack.size();
+			for (int c = first_child[s]; c >= 0; c = next_sibling[c]) {
+				stack.push_back(c);
+			}
+			std::reverse(stack.begin() + mark, stack.end());
+		}
+	}
+	root_begin_.push_back((int)order.size());
+
+	// Permute the packed arrays
+	std::vector<int> new_parent(num);
+	std::vector<glm::vec3> new_position(num), new_scale(num), new_origin(num);
+	std::vector<glm::quat> new_orientation(num);
+	std::vector<glm::mat4> new_local(num), new_world(num);
+	std::vector<Bounds> new_bounds(num), new_world_bounds(num), new_subtree_bounds(num);
+	std::vector<unsigned char> new_dirty(num), new_changed(num);
+	for (int i = 0; i < num; i++) {
+		int old = slot_index_[order[i]];
+		new_position[i] = position_[old];
+		new_orientation[i] = orientation_[old];
+		new_scale[i] = scale_[old];
+		new_origin[i] = origin_[old];
+		new_local[i] = local_[old];
+		new_world[i] = world_[old];
+		new_bounds[i] = bounds_[old];
+		new_world_bounds[i] = world_bounds_[old];
+		new_subtree_bounds[i] = subtree_bounds_[old];
+		new_dirty[i] = dirty_[old];
+		new_changed[i] = 0;
+	}
+	for (int i = 0; i < num; i++) {
+		slot_index_[order[i]] = i;
+	}
+	for (int i = 0; i < num; i++) {
+		int p = slot_parent_[order[i]];
+		new_parent[i] = Contains(p) ? slot_index_[p] : -1;
+	}
+
+	slot_.swap(order);
+	parent_.swap(new_parent);
+	position_.swap(new_position);
+	orientation_.swap(new_orientation);
+	scale_.swap(new_scale);
+	origin_.swap(new_origin);
+	local_.swap(new_local);
+	world_.swap(new_world);
+	bounds_.swap(new_bounds);
+	world_bounds_.swap(new_world_bounds);
+	subtree_bounds_.swap(new_subtree_bounds);
+	dirty_.swap(new_dirty);
+	changed_.swap(new_changed);
+	order_dirty_ = false;
+}
+
+
+void TransformStore::UpdateRange(int begin, int end) {
+
+	for (int i = begin; i < end; i++) {
+		if (dirty_[i]) {
+			glm::mat4 scaling = glm::scale(glm::mat4(1.0), scale_[i]);
+			glm::mat4 rotation = glm::mat4_cast(orientation_[i]);
+			glm::mat4 translation = glm::translate(glm::mat4(1.0), position_[i]);
+			glm::mat4 origin = glm::translate(glm::mat4(1.0), -origin_[i]);
+			local_[i] = translation * rotation * origin * scaling;
+		}
+
+		int p = parent_[i];
+		bool changed = dirty_[i] || (p >= 0 && changed_[p]);
+		if (changed) {
+			world_[i] = p >= 0 ? world_[p] * local_[i] : local_[i];
+			world_bounds_[i] = bounds_[i].Transform(world_[i]);
+		}
+		changed_[i] = changed;
+		dirty_[i] = 0;
+		subtree_bounds_[i] = world_bounds_[i];
+	}
+
+	// Children come after their parent, so walking back merges every
+	// subtree into its parent once it is complete
+	for (int i = end - 1; i >= begin; i--) {
+		int p = parent_[i];
+		if (p >= 0) {
+			subtree_bounds_[p].Extend(subtree_bounds_[i]);
+		}
+	}
+}
+
+
+void TransformStore::Update(WorkerPool *pool) {
+
+	if (order_dirty_) {
+		Rebuild();
+	}
+
+	int num = (int)slot_.size();
+	int num_roots = (int)root_begin_.size() - 1;
+	if (!pool || pool->GetConcurrency() <= 1 || num < parallel_threshold_ || num_roots < 2) {
+		UpdateRange(0, num);
+		return;
+	}
+
+	// Group whole root subtrees into chunks of roughly equal size
+	int num_chunks = pool->GetConcurrency() * 4;
+	int target = (num + num_chunks - 1) / num_chunks;
+	std::vector<int> chunk_begin;
+	chunk_begin.push_back(0);
+	for (int r = 1; r < num_roots; r++) {
+		if (root_begin_[r] - chunk_begin.back() >= target) {
+			chunk_begin.push_back(root_begin_[r]);
+		}
+	}
+	chunk_begin.push_back(num);
+
+	pool->Run((int)chunk_begin.size() - 1, [this, &chunk_begin](int c) {
+		UpdateRange(chunk_begin[c], chunk_begin[c + 1]);
+	});
+}
+
+} // namespace game
@@ -0,0 +1,95 @@
+#ifndef TRANSFORM_STORE_H_
+#define TRANSFORM_STORE_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "worker_pool.h"
+#include "bounds.h"
+
+namespace game {
+
+	// Structure-of-arrays storage for the transforms of a scene graph
+	// Transforms are addressed by slot (the handle of the node that owns
+	// them). Internally they are packed in contiguous arrays sorted so that
+	// parents always come before their children and every root subtree is
+	// one contiguous range, which lets world matrices be computed in a
+	// single linear pass, and bounds of whole subtrees gathered in a single
+	// pass back
+	class TransformStore {
+
+	public:
+		TransformStore(void);
+		~TransformStore();
+
+		// Add/remove the transform of a slot
+		void Insert(int slot, int parent_slot);
+		void Remove(int slot);
+		void SetParent(int slot, int parent_slot);
+		bool Contains(int slot) const;
+		// Make room for 'count' more transforms, up to slot 'max_slot'
+		void Reserve(int count, int max_slot);
+
+		// Copy the local transform components of a slot
+		void SetLocal(int slot, const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale, const glm::vec3 &origin);
+
+		// Local position of a slot, as of the last SetLocal
+		const glm::vec3 &GetPosition(int slot) const { return position_[slot_index_[slot]]; }
+
+		// World matrix of a slot, as of the last Update
+		const glm::mat4 &GetWorld(int slot) const;
+
+		// Object-space bounds of the geometry of a slot
+		void SetBounds(int slot, const Bounds &bounds);
+		// World-space bounds of a slot and all its descendants, as of the
+		// last Update
+		const Bounds &GetSubtreeBounds(int slot) const;
+
+		// Recompute the world matrices of changed transforms
+		// Root subtrees are split across the pool when there are enough of them
+		void Update(WorkerPool *pool);
+
+		// Remove every transform
+		void Clear(void);
+
+		// Minimum number of transforms before the pass is split across threads
+		void SetParallelThreshold(int t) { parallel_threshold_ = t; }
+
+	private:
+		// Sort the packed arrays parents-first, grouped by root subtree
+		void Rebuild(void);
+		// Linear pass over packed indices [begin, end), which hold whole
+		// root subtrees
+		void UpdateRange(int begin, int end);
+
+		// Per slot
+		std::vector<int> slot_index_; // packed index of the slot, -1 if unused
+		std::vector<int> slot_parent_; // parent slot, -1 for roots
+
+		// Packed, parents before children
+		std::vector<int> slot_;
+		std::vector<int> parent_; // packed index of the parent, -1 for roots
+		std::vector<glm::vec3> position_;
+		std::vector<glm::quat> orientation_;
+		std::vector<glm::vec3> scale_;
+		std::vector<glm::vec3> origin_;
+		std::vector<glm::mat4> local_;
+		std::vector<glm::mat4> world_;
+		std::vector<Bounds> bounds_; // object space
+		std::vector<Bounds> world_bounds_; // of the slot alone
+		std::vector<Bounds> subtree_bounds_;
+		std::vector<unsigned char> dirty_; // local transform changed
+		std::vector<unsigned char> changed_; // world matrix changed in this pass
+
+		// Packed ranges of the root subtrees: [root_begin_[i], root_begin_[i+1])
+		std::vector<int> root_begin_;
+		bool order_dirty_;
+		int parallel_threshold_;
+
+	}; // class TransformStore
+
+} // namespace game
+
+#endif // TRANSFORM_STORE_H_
@@ -0,0 +1,115 @@
+#include <cstring>
+
+#include "uniform_blocks.h"
+#include "shader_program.h"
+#include "gl_state.h"
+
+namespace game {
+
+GLuint UniformBlocks::frame_buffer_ = 0;
+GLuint UniformBlocks::object_ring_ = 0;
+GLsizeiptr UniformBlocks::object_capacity_ = OBJECT_RING_CAPACITY;
+GLsizeiptr UniformBlocks::object_head_ = 0;
+std::vector<ObjectData> UniformBlocks::objects_;
+
+
+void UniformBlocks::Init(void) {
+
+	// Frame block
+	glGenBuffers(1, &frame_buffer_);
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer_);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, frame_buffer_);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Object ring
+	glGenBuffers(1, &object_ring_);
+	glBindBuffer(GL_ARRAY_BUFFER, object_ring_);
+	glBufferData(GL_ARRAY_BUFFER, object_capacity_, NULL, GL_STREAM_DRAW);
+	object_head_ = 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void UniformBlocks::BindProgram(GLuint program) {
+
+	GLuint frame = glGetUniformBlockIndex(program, "FrameBlock");
+	if (frame != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, frame, FRAME_BLOCK_BINDING);
+	}
+}
+
+
+void UniformBlocks::SetupObjects(void) {
+
+	// A matrix attribute takes one location per column
+	glBindBuffer(GL_ARRAY_BUFFER, object_ring_);
+	for (GLuint i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(WORLD_MAT_ATTRIB + i);
+		glVertexAttribDivisor(WORLD_MAT_ATTRIB + i, 1);
+		glEnableVertexAttribArray(NORMAL_MAT_ATTRIB + i);
+		glVertexAttribDivisor(NORMAL_MAT_ATTRIB + i, 1);
+	}
+	PointObjects(0);
+}
+
+
+void UniformBlocks::PointObjects(GLintptr offset) {
+
+	for (GLuint i = 0; i < 4; i++) {
+		glVertexAttribPointer(WORLD_MAT_ATTRIB + i, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectData), (const GLvoid *)(offset + i * sizeof(glm::vec4)));
+		glVertexAttribPointer(NORMAL_MAT_ATTRIB + i, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectData), (const GLvoid *)(offset + sizeof(glm::mat4) + i * sizeof(glm::vec4)));
+	}
+}
+
+
+void UniformBlocks::SetFrame(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camera_pos, float timer) {
+
+	FrameBlock block;
+	block.view_mat = view;
+	block.projection_mat = projection;
+	block.camera_pos = camera_pos;
+	block.timer = timer;
+
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, frame_buffer_);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &block);
+}
+
+
+void UniformBlocks::PushObjects(const glm::mat4 *world, int count) {
+
+	objects_.resize(count);
+	for (int i = 0; i < count; i++) {
+		objects_[i].world_mat = world[i];
+		objects_[i].normal_mat = glm::transpose(glm::inverse(world[i]));
+	}
+	GLsizeiptr size = count * sizeof(ObjectData);
+
+	GLState::BindBuffer(GL_ARRAY_BUFFER, object_ring_);
+
+	// Start over in a fresh buffer once the ring is full, a larger one if
+	// the draw alone does not fit
+	if (object_head_ + size > object_capacity_) {
+		while (size > object_capacity_) {
+			object_capacity_ *= 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, object_capacity_, NULL, GL_STREAM_DRAW);
+		object_head_ = 0;
+	}
+
+	void *dst = glMapBufferRange(GL_ARRAY_BUFFER, object_head_, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst) {
+		memcpy(dst, objects_.data(), size);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	else {
+		glBufferSubData(GL_ARRAY_BUFFER, object_head_, size, objects_.data());
+	}
+
+	// Vertex data offsets need no alignment beyond the one of a float
+	PointObjects(object_head_);
+	object_head_ += size;
+}
+
+} // namespace game
@@ -0,0 +1,76 @@
+#ifndef UNIFORM_BLOCKS_H_
+#define UNIFORM_BLOCKS_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Binding point of the uniform block shared by all programs
+#define FRAME_BLOCK_BINDING 0
+
+// Initial size of the object ring, in bytes; grows when a draw needs more
+#define OBJECT_RING_CAPACITY (1024 * 1024)
+
+namespace game {
+
+	// Layout of "FrameBlock" (std140): set once per frame from the camera
+	struct FrameBlock {
+		glm::mat4 view_mat;
+		glm::mat4 projection_mat;
+		glm::vec3 camera_pos;
+		float timer;
+	};
+
+	// Per-instance attributes "world_mat" and "normal_mat": one entry per
+	// instance of a draw, advanced once per instance
+	struct ObjectData {
+		glm::mat4 world_mat;
+		glm::mat4 normal_mat;
+	};
+
+	// Buffers behind the frame block and the object attributes of the shaders
+	// The frame block is one small buffer updated once per frame (or per
+	// overlay). Object data is streamed into a ring vertex buffer; each draw
+	// points the object attributes of its vertex array at its own range, and
+	// the ring is orphaned when it wraps so that data still read by the GPU
+	// is never overwritten. A draw holds any number of instances
+	class UniformBlocks {
+
+	public:
+		// Create the buffers; needs a current context
+		static void Init(void);
+
+		// Attach the blocks of a linked program to the shared binding points
+		static void BindProgram(GLuint program);
+
+		// Enable the object attributes in the bound vertex array; done once
+		// for every vertex array drawn with PushObjects
+		static void SetupObjects(void);
+
+		// Upload the frame block
+		static void SetFrame(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camera_pos, float timer);
+
+		// Stream the object data of the next draw and point the bound vertex
+		// array at it; an instanced draw passes the world matrices of all its
+		// instances, and the commands of a multi-draw find theirs from their
+		// base instance
+		static void PushObjects(const glm::mat4 *world, int count);
+		static void PushObject(const glm::mat4 &world) { PushObjects(&world, 1); }
+
+	private:
+		// Point the object attributes of the bound vertex array at 'offset'
+		// in the ring
+		static void PointObjects(GLintptr offset);
+
+		static GLuint frame_buffer_;
+		static GLuint object_ring_;
+		static GLsizeiptr object_capacity_; // bytes
+		static GLsizeiptr object_head_; // first free byte of the ring
+		static std::vector<ObjectData> objects_; // staging for the next draw
+
+	}; // class UniformBlocks
+
+} // namespace game
+
+#endif // UNIFORM_BLOCKS_H_
@@ -0,0 +1,200 @@
+#ifndef VERTEX_LAYOUT_H_
+#define VERTEX_LAYOUT_H_
+
+#include <vector>
+#include <cstring>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "shader_program.h"
+
+// Floats per vertex of the interleaved layout the creators and loaders
+// write: position, normal, color, uv
+#define SOURCE_VERTEX_FLOATS 11
+
+namespace game {
+
+	// Encodings: how one attribute of a source vertex is stored on the GPU
+	// 'source_components' floats are read from the source vertex and
+	// 'components' values of 'type' are written, in 'bytes' bytes
+
+	// Floats as they are
+	template <int N> struct FloatEncoding {
+		static const int source_components = N;
+		static const GLint components = N;
+		static const GLenum type = GL_FLOAT;
+		static const GLboolean normalized = GL_FALSE;
+		static const GLsizei bytes = N * sizeof(GLfloat);
+		static void Pack(const GLfloat *source, unsigned char *packed) { memcpy(packed, source, bytes); }
+	};
+
+	// Two floats as half floats, for texture coordinates
+	struct Half2Encoding {
+		static const int source_components = 2;
+		static const GLint components = 2;
+		static const GLenum type = GL_HALF_FLOAT;
+		static const GLboolean normalized = GL_FALSE;
+		static const GLsizei bytes = 4;
+		static void Pack(const GLfloat *source, unsigned char *packed) {
+			glm::uint value = glm::packHalf2x16(glm::vec2(source[0], source[1]));
+			memcpy(packed, &value, bytes);
+		}
+	};
+
+	// Three floats in [-1, 1] as signed normalized 10-bit integers, for
+	// normals; the 2-bit w is left at 0
+	struct Snorm10Encoding {
+		static const int source_components = 3;
+		static const GLint components = 4;
+		static const GLenum type = GL_INT_2_10_10_10_REV;
+		static const GLboolean normalized = GL_TRUE;
+		static const GLsizei bytes = 4;
+		static void Pack(const GLfloat *source, unsigned char *packed) {
+			glm::uint32 value = glm::packSnorm3x10_1x2(glm::vec4(source[0], source[1], source[2], 0.0f));
+			memcpy(packed, &value, bytes);
+		}
+	};
+
+	// Three floats in [0, 1] as normalized bytes, for colors; padded to four
+	// bytes to keep the attributes aligned
+	struct Unorm8Encoding {
+		static const int source_components = 3;
+		static const GLint components = 4;
+		static const GLenum type = GL_UNSIGNED_BYTE;
+		static const GLboolean normalized = GL_TRUE;
+		static const GLsizei bytes = 4;
+		static void Pack(const GLfloat *source, unsigned char *packed) {
+			glm::uint value = glm::packUnorm4x8(glm::vec4(source[0], source[1], source[2], 1.0f));
+			memcpy(packed, &value, bytes);
+		}
+	};
+
+	// One attribute of a layout: the shader location it feeds, the offset
+	// of its floats in the source vertex and its encoding
+	template <GLuint Location, int SourceOffset, typename Encoding_> struct VertexAttribute {
+		static const GLuint location = Location;
+		static const int source_offset = SourceOffset;
+		typedef Encoding_ Encoding;
+	};
+
+	// Runtime handle on a layout, for code that stores geometry of any layout
+	struct VertexFormat {
+		GLsizei stride; // bytes per packed vertex
+		// Convert 'count' vertices from the source layout to this one
+		void (*pack)(const GLfloat *source, GLsizei count, unsigned char *packed);
+		// Point the attributes at the bound GL_ARRAY_BUFFER, in the bound vertex array
+		void (*setup)(void);
+	};
+
+	// Vertex layout declared as a list of attributes, packed one after the
+	// other; the packing code and the attribute setup are both generated
+	// from the list, so they cannot disagree
+	template <typename... Attributes> struct VertexLayout;
+
+	template <> struct VertexLayout<> {
+		static const GLsizei stride = 0;
+		static void PackVertex(const GLfloat *, unsigned char *) {}
+		static void SetupAttributes(GLsizei, size_t) {}
+	};
+
+	template <typename First, typename... Rest> struct VertexLayout<First, Rest...> {
+
+		typedef typename First::Encoding Encoding;
+		typedef VertexLayout<Rest...> Tail;
+
+		static const GLsizei stride = Encoding::bytes + Tail::stride;
+
+		static void PackVertex(const GLfloat *source, unsigned char *packed) {
+			Encoding::Pack(source + First::source_offset, packed);
+			Tail::PackVertex(source, packed + Encoding::bytes);
+		}
+
+		static void SetupAttributes(GLsizei vertex_stride, size_t offset) {
+			glVertexAttribPointer(First::location, Encoding::components, Encoding::type, Encoding::normalized, vertex_stride, (const GLvoid *)offset);
+			glEnableVertexAttribArray(First::location);
+			Tail::SetupAttributes(vertex_stride, offset + Encoding::bytes);
+		}
+
+		static void Pack(const GLfloat *source, GLsizei count, unsigned char *packed) {
+			for (GLsizei i = 0; i < count; i++) {
+				PackVertex(source + i * SOURCE_VERTEX_FLOATS, packed + i * stride);
+			}
+		}
+
+		static void Setup(void) {
+			SetupAttributes(stride, 0);
+		}
+
+		static const VertexFormat &Format(void) {
+			static const VertexFormat format = { stride, &Pack, &Setup };
+			return format;
+		}
+	};
+
+	// The source layout itself (44 bytes); point sets keep it, since their
+	// shader uses the color as a time offset and needs its precision
+	typedef VertexLayout<
+		VertexAttribute<VERTEX_ATTRIB, 0, FloatEncoding<3> >,
+		VertexAttribute<NORMAL_ATTRIB, 3, FloatEncoding<3> >,
+		VertexAttribute<COLOR_ATTRIB, 6, FloatEncoding<3> >,
+		VertexAttribute<UV_ATTRIB, 9, FloatEncoding<2> > > SourceVertex;
+
+	// Meshes with vertex colors (24 bytes)
+	typedef VertexLayout<
+		VertexAttribute<VERTEX_ATTRIB, 0, FloatEncoding<3> >,
+		VertexAttribute<NORMAL_ATTRIB, 3, Snorm10Encoding>,
+		VertexAttribute<COLOR_ATTRIB, 6, Unorm8Encoding>,
+		VertexAttribute<UV_ATTRIB, 9, Half2Encoding> > ColoredVertex;
+
+	// Meshes whose colors are all zero (20 bytes): with the attribute
+	// disabled the shaders read the default value, (0, 0, 0) as well
+	typedef VertexLayout<
+		VertexAttribute<VERTEX_ATTRIB, 0, FloatEncoding<3> >,
+		VertexAttribute<NORMAL_ATTRIB, 3, Snorm10Encoding>,
+		VertexAttribute<UV_ATTRIB, 9, Half2Encoding> > PlainVertex;
+
+	// Whether any vertex of source geometry has a color
+	inline bool HasColor(const GLfloat *source, GLsizei count) {
+		for (GLsizei i = 0; i < count; i++) {
+			const GLfloat *color = source + i * SOURCE_VERTEX_FLOATS + 6;
+			if (color[0] != 0 || color[1] != 0 || color[2] != 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Format of the packed layout suited to source geometry
+	inline const VertexFormat &PackedFormat(const GLfloat *source, GLsizei count) {
+		return HasColor(source, count) ? ColoredVertex::Format() : PlainVertex::Format();
+	}
+
+	// Smallest index type able to address 'vertex_count' vertices
+	inline GLenum IndexType(GLsizei vertex_count) {
+		return vertex_count <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
+
+	// Bytes per index of a type
+	inline size_t IndexSize(GLenum type) {
+		return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+
+	// Convert indices to a type
+	inline void PackIndices(const GLuint *face, GLsizei size, GLenum type, std::vector<unsigned char> &packed) {
+		packed.resize(size * IndexSize(type));
+		if (type == GL_UNSIGNED_SHORT) {
+			for (GLsizei i = 0; i < size; i++) {
+				GLushort index = (GLushort)face[i];
+				memcpy(&packed[i * sizeof(GLushort)], &index, sizeof(GLushort));
+			}
+		}
+		else if (size > 0) {
+			memcpy(packed.data(), face, size * sizeof(GLuint));
+		}
+	}
+
+} // namespace game
+
+#endif // VERTEX_LAYOUT_H_
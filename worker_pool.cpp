@@ -0,0 +1,114 @@
+#include "worker_pool.h"
+
+namespace game {
+
+WorkerPool::WorkerPool(int num_workers) {
+
+	job_ = NULL;
+	num_jobs_ = 0;
+	next_job_ = 0;
+	pending_ = 0;
+	batch_ = 0;
+	quit_ = false;
+
+	if (num_workers < 0) {
+		int cores = (int)std::thread::hardware_concurrency();
+		num_workers = cores > 1 ? cores - 1 : 0;
+	}
+	for (int i = 0; i < num_workers; i++) {
+		workers_.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+
+WorkerPool::~WorkerPool() {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+	for (size_t i = 0; i < workers_.size(); i++) {
+		workers_[i].join();
+	}
+}
+
+
+void WorkerPool::Run(int num_jobs, const std::function<void(int)> &job) {
+
+	if (num_jobs <= 0) {
+		return;
+	}
+
+	// Nothing to share, avoid waking the workers
+	if (workers_.empty() || num_jobs == 1) {
+		for (int i = 0; i < num_jobs; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &job;
+		num_jobs_ = num_jobs;
+		next_job_ = 0;
+		pending_ = num_jobs;
+		batch_++;
+	}
+	wake_.notify_all();
+
+	Drain();
+
+	// Wait for the jobs still running on the workers
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return pending_ == 0; });
+	job_ = NULL;
+}
+
+
+void WorkerPool::Drain(void) {
+
+	while (true) {
+		int index;
+		const std::function<void(int)> *job;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (job_ == NULL || next_job_ >= num_jobs_) {
+				return;
+			}
+			index = next_job_++;
+			job = job_;
+		}
+
+		(*job)(index);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			last = (--pending_ == 0);
+		}
+		if (last) {
+			done_.notify_all();
+		}
+	}
+}
+
+
+void WorkerPool::WorkerLoop(void) {
+
+	unsigned int seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this, seen] { return quit_ || batch_ != seen; });
+			if (quit_) {
+				return;
+			}
+			seen = batch_;
+		}
+		Drain();
+	}
+}
+
+} // namespace game
@@ -0,0 +1,50 @@
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace game {
+
+	// Small pool of persistent worker threads used to split per-frame work
+	// The calling thread takes part in the work, so a pool created with no
+	// workers simply runs every job serially
+	class WorkerPool {
+
+	public:
+		// Create the pool; a negative count uses one worker per extra core
+		WorkerPool(int num_workers = -1);
+		~WorkerPool();
+
+		// Number of threads that take part in a Run (workers + caller)
+		int GetConcurrency(void) const { return (int)workers_.size() + 1; }
+
+		// Run job(i) for every i in [0, num_jobs) and wait until all are done
+		void Run(int num_jobs, const std::function<void(int)> &job);
+
+	private:
+		void WorkerLoop(void);
+		// Take and run jobs of the current batch until none is left
+		void Drain(void);
+
+		std::vector<std::thread> workers_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+
+		// Current batch
+		const std::function<void(int)> *job_;
+		int num_jobs_;
+		int next_job_;
+		int pending_;
+		unsigned int batch_; // incremented for every batch, wakes the workers
+		bool quit_;
+
+	}; // class WorkerPool
+
+} // namespace game
+
+#endif // WORKER_POOL_H_